@@ -0,0 +1,330 @@
+// Replays mjpeg frames through camsrv's decode, encode and send paths. Frames are read from the
+// directory in CAMSRV_BENCH_FRAMES (every .jpg in it, in name order) if it's set, otherwise test
+// frames are made up at a few common camera resolutions. The send benchmarks go through a real
+// Server and a client connected to it over loopback.
+
+// standard includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// boost includes
+#include <boost/asio.hpp>
+
+// benchmark includes
+#include <benchmark/benchmark.h>
+
+// opencv include
+#include <opencv2/imgcodecs.hpp>
+
+#include "camsrv_msg.hpp"
+#include "decoder.hpp"
+#include "encoder_pool.hpp"
+#include "frame.hpp"
+#include "server.hpp"
+#include "stats.hpp"
+
+#define DEFAULT_BENCH_PORT 47011  // CAMSRV_BENCH_PORT picks another one
+#define KEEP_ALIVE_INTERVAL_SECONDS 5
+
+namespace {
+// every allocation made by any thread, counted so a benchmark can tell how many a frame costs
+std::atomic<std::uint64_t> allocations{0};
+
+struct Frame_Set {
+    std::string name;
+    std::vector<Frame_Ptr> frames;
+};
+
+// frames of width x height with enough detail in them to compress like a camera's would
+Frame_Set make_frames(int width, int height) {
+    Frame_Set set{std::to_string(width) + "x" + std::to_string(height), {}};
+
+    cv::Mat image(height, width, CV_8UC3);
+    std::uint32_t noise = 12345;
+    for (int f = 0; f < 8; f++) {
+        for (int y = 0; y < height; y++) {
+            auto row = image.ptr<std::uint8_t>(y);
+            for (int x = 0; x < width * 3; x++) {
+                noise = noise * 1103515245 + 12345;
+                row[x] = static_cast<std::uint8_t>(((x + f * 16) ^ y) + (noise >> 28));
+            }
+        }
+
+        std::vector<std::uint8_t> jpeg;
+        cv::imencode(".jpg", image, jpeg);
+        set.frames.push_back(std::make_shared<const Frame>(
+            std::move(jpeg), Frame::Format::JPEG, static_cast<std::uint16_t>(width),
+            static_cast<std::uint16_t>(height)));
+    }
+
+    return set;
+}
+
+Frame_Set load_frames(const std::string &directory) {
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        auto extension = entry.path().extension();
+        if (extension == ".jpg" || extension == ".jpeg") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    Frame_Set set{"recorded", {}};
+    for (const auto &p : paths) {
+        std::ifstream file(p, std::ios::binary);
+        std::vector<std::uint8_t> jpeg((std::istreambuf_iterator<char>(file)),
+                                       std::istreambuf_iterator<char>());
+
+        // decoded once up front for its size, the half size benchmarks need it
+        auto image = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            std::cerr << "skipping " << p << ", it couldn't be decoded" << std::endl;
+            continue;
+        }
+        set.frames.push_back(std::make_shared<const Frame>(
+            std::move(jpeg), Frame::Format::JPEG, static_cast<std::uint16_t>(image.cols),
+            static_cast<std::uint16_t>(image.rows)));
+    }
+
+    return set;
+}
+
+// latency percentiles, frames per second and allocations per frame, the same for every benchmark
+void report(benchmark::State &state, const Histogram &latency, std::uint64_t allocations_before) {
+    Histogram_Snapshot snapshot;
+    latency.add_to(snapshot);
+
+    auto frames = static_cast<double>(state.iterations());
+    state.SetItemsProcessed(state.iterations());
+    state.counters["frames_per_second"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+    state.counters["p50_us"] = snapshot.percentile(50) / 1000.0;
+    state.counters["p99_us"] = snapshot.percentile(99) / 1000.0;
+    state.counters["allocations_per_frame"] = (allocations - allocations_before) / frames;
+}
+
+void bm_decode(benchmark::State &state, const Frame_Set *set, int divisor) {
+    Decoder decoder;
+    Histogram latency;
+    std::size_t i = 0;
+    auto allocations_before = allocations.load();
+
+    for (auto _ : state) {
+        const auto &frame = *set->frames.at(i++ % set->frames.size());
+        auto start = Histogram::now_ns();
+        const auto &image =
+            decoder.decode(frame, frame.width() / divisor, frame.height() / divisor);
+        latency.record_since(start);
+        benchmark::DoNotOptimize(image.data);
+        if (image.empty()) {
+            state.SkipWithError("couldn't decode frame");
+            break;
+        }
+    }
+
+    report(state, latency, allocations_before);
+}
+
+// decoding and encoding on the encoder pool, results come back through the io service like they
+// do for the server
+void bm_transcode(benchmark::State &state, const Frame_Set *set, Frame::Format format) {
+    boost::asio::io_service io_service;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard(
+        io_service.get_executor());
+    Encoder_Pool encoder_pool(io_service, 1, 1);
+    Histogram latency;
+    std::size_t i = 0;
+    auto allocations_before = allocations.load();
+
+    for (auto _ : state) {
+        Frame_Ptr encoded;
+        bool done = false;
+        auto start = Histogram::now_ns();
+        encoder_pool.encode(0, set->frames.at(i++ % set->frames.size()), {format, 0, 0},
+                            [&](Frame_Ptr ef) {
+                                encoded = std::move(ef);
+                                done = true;
+                            });
+        while (!done) io_service.run_one();
+        latency.record_since(start);
+
+        if (!encoded) {
+            state.SkipWithError("couldn't encode frame");
+            break;
+        }
+    }
+
+    report(state, latency, allocations_before);
+}
+
+// A server on its own thread with a single client connected to it over loopback, streaming the
+// one camera the server has in the format the client asked for.
+class Loopback {
+public:
+    Loopback(std::uint16_t port, camsrv::camsrv_message::camsrv_format format)
+        : client(client_service) {
+        encoder_pool = std::make_shared<Encoder_Pool>(io_service, 1, 1);
+        std::vector<std::unique_ptr<Shm_Ring>> shm_rings(1);
+        server = std::make_shared<Server>(
+            io_service, port, encoder_pool, std::move(shm_rings), [](std::uint32_t, bool) {}, 0);
+        thread = std::thread([this]() { io_service.run(); });
+
+        client.connect(
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+        camsrv::camsrv_message request;
+        request.command = camsrv::camsrv_message::camsrv_command::HELLO;
+        boost::asio::write(client, boost::asio::buffer(&request, camsrv::LEGACY_MESSAGE_SIZE));
+        receive();
+
+        request.command = camsrv::camsrv_message::camsrv_command::SET_FORMAT;
+        request.format = format;
+        send(request);
+        request.command = camsrv::camsrv_message::camsrv_command::STREAM_ON;
+        send(request);
+
+        // commands are handled in order, once this is answered the client is streaming
+        request.command = camsrv::camsrv_message::camsrv_command::SHM_INFO;
+        send(request);
+        receive();
+    }
+
+    ~Loopback() {
+        boost::system::error_code ec;
+        client.close(ec);
+        io_service.stop();
+        thread.join();
+        server.reset();
+    }
+
+    // hands the server a frame the way a camera does, returns once the client has all of it
+    std::size_t send_frame(const Frame_Ptr &frame) {
+        boost::asio::post(io_service, [this, frame]() { server->send_frame(0, frame); });
+        auto size = receive();
+
+        // subscribers that go quiet for too long get dropped
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_keep_alive > std::chrono::seconds(KEEP_ALIVE_INTERVAL_SECONDS)) {
+            camsrv::camsrv_message keep_alive;
+            keep_alive.command = camsrv::camsrv_message::camsrv_command::KEEP_ALIVE;
+            send(keep_alive);
+            last_keep_alive = now;
+        }
+
+        return size;
+    }
+
+private:
+    void send(const camsrv::camsrv_message &message) {
+        boost::asio::write(client, boost::asio::buffer(&message, sizeof(message)));
+    }
+
+    std::size_t receive() {
+        camsrv::camsrv_message header;
+        boost::asio::read(client, boost::asio::buffer(&header, sizeof(header)));
+        payload.resize(header.size);
+        boost::asio::read(client, boost::asio::buffer(payload));
+        return header.size;
+    }
+
+    // server side, io service has to outlive everything else
+    boost::asio::io_service io_service;
+    std::shared_ptr<Encoder_Pool> encoder_pool;
+    std::shared_ptr<Server> server;
+    std::thread thread;
+
+    // client side
+    boost::asio::io_service client_service;
+    boost::asio::ip::tcp::socket client;
+    std::vector<std::uint8_t> payload;  // reused for every frame
+    std::chrono::steady_clock::time_point last_keep_alive = std::chrono::steady_clock::now();
+};
+
+void bm_send(benchmark::State &state, const Frame_Set *set, std::uint16_t port,
+             camsrv::camsrv_message::camsrv_format format) {
+    Loopback loopback(port, format);
+    Histogram latency;
+    std::size_t i = 0;
+    std::uint64_t bytes = 0;
+    auto allocations_before = allocations.load();
+
+    for (auto _ : state) {
+        auto start = Histogram::now_ns();
+        bytes += loopback.send_frame(set->frames.at(i++ % set->frames.size()));
+        latency.record_since(start);
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    report(state, latency, allocations_before);
+}
+}  // namespace
+
+// counting allocations, frees don't need counting but have to match
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    std::vector<Frame_Set> sets;
+    if (auto directory = std::getenv("CAMSRV_BENCH_FRAMES")) {
+        sets.push_back(load_frames(directory));
+        if (sets.back().frames.empty()) {
+            std::cerr << "no .jpg frames found in " << directory << std::endl;
+            return 1;
+        }
+    } else {
+        sets.push_back(make_frames(320, 240));
+        sets.push_back(make_frames(1280, 720));
+        sets.push_back(make_frames(1920, 1080));
+    }
+
+    std::uint16_t port = DEFAULT_BENCH_PORT;
+    if (auto p = std::getenv("CAMSRV_BENCH_PORT")) port = static_cast<std::uint16_t>(std::atoi(p));
+
+    // the server can only be bound to the port once at a time, benchmarks run one after the other
+    using format = camsrv::camsrv_message::camsrv_format;
+    for (const auto &s : sets) {
+        auto set = &s;
+        benchmark::RegisterBenchmark(("decode/" + s.name).c_str(), bm_decode, set, 1)
+            ->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("decode_half/" + s.name).c_str(), bm_decode, set, 2)
+            ->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("transcode_png/" + s.name).c_str(), bm_transcode, set,
+                                     format::PNG)
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("send_jpeg/" + s.name).c_str(), bm_send, set, port,
+                                     format::JPEG)
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("send_png/" + s.name).c_str(), bm_send, set, port,
+                                     format::PNG)
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("send_bgr/" + s.name).c_str(), bm_send, set, port,
+                                     format::BGR)
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Compares a camsrv_bench run against the baseline, exits non zero if anything got slower.
+
+usage: compare.py baseline.json current.json [threshold percent, 10 by default]
+
+Medians are compared when the runs were repeated, single runs are compared as they are.
+"""
+
+import json
+import os
+import sys
+
+# higher is worse for all of these
+MEASUREMENTS = ("real_time", "p99_us", "allocations_per_frame")
+
+
+def load(path):
+    with open(path) as f:
+        benchmarks = json.load(f)["benchmarks"]
+
+    results = {}
+    for b in benchmarks:
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        results[b.get("run_name", b["name"])] = b
+    return results
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    if not os.path.exists(sys.argv[1]):
+        print(f"no baseline at {sys.argv[1]}, run camsrv_bench_baseline first to record one",
+              file=sys.stderr)
+        return 1
+
+    baseline = load(sys.argv[1])
+    current = load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) == 4 else 10.0
+
+    regressions = 0
+    for name, b in sorted(current.items()):
+        if name not in baseline:
+            print(f"{name}: not in the baseline")
+            continue
+
+        for m in MEASUREMENTS:
+            before, after = baseline[name].get(m), b.get(m)
+            if before is None or after is None:
+                continue
+
+            if before:
+                change = (after - before) / before * 100
+                regressed = change > threshold
+            else:
+                change = 0.0
+                regressed = after > 0  # e.g. a frame that used to need no allocations
+            regressions += regressed
+            print(f"{name} {m}: {before:.2f} -> {after:.2f} ({change:+.1f}%)"
+                  f"{' REGRESSION' if regressed else ''}")
+
+    if regressions:
+        print(f"{regressions} measurements regressed by more than {threshold}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
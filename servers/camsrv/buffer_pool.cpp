@@ -0,0 +1,48 @@
+#include "buffer_pool.hpp"
+
+Buffer_Pool::Buffer_Pool(std::size_t bs, std::size_t mfb)
+    : maximum_free_buffers(mfb), buffer_size(bs) {}
+
+Buffer_Pool::Buffer Buffer_Pool::acquire() {
+    Buffer buffer;
+    std::size_t size;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size = buffer_size;
+        if (!free_buffers.empty()) {
+            buffer = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+
+    // growing outside of the lock, nothing else can see this buffer anymore
+    if (!buffer) buffer = std::make_unique<std::vector<std::uint8_t>>();
+    if (buffer->size() < size) buffer->resize(size);
+    return buffer;
+}
+
+void Buffer_Pool::release(Buffer buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_buffers.size() < maximum_free_buffers) free_buffers.push_back(std::move(buffer));
+}
+
+Frame_Ptr Buffer_Pool::make_frame(Buffer buffer, std::size_t offset, std::size_t size,
+                                  Frame::Format format, std::uint16_t width, std::uint16_t height,
+                                  Frame::Type type, Capture_Info capture) {
+    // the frame's release callback keeps the pool alive for as long as the frame is around
+    auto raw = buffer.release();
+    return std::make_shared<const Frame>(
+        raw->data() + offset, size,
+        [self = shared_from_this(), raw]() { self->release(Buffer(raw)); }, format, width, height,
+        type, capture);
+}
+
+void Buffer_Pool::grow(std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size > buffer_size) buffer_size = size;
+}
+
+std::size_t Buffer_Pool::get_buffer_size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return buffer_size;
+}
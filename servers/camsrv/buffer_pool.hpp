@@ -0,0 +1,40 @@
+#ifndef buffer_pool__HPP
+#define buffer_pool__HPP
+
+// standard includes
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "frame.hpp"
+
+// Hands out receive buffers and takes them back once the frame made from them has been released,
+// so a stream reuses the same few buffers rather than allocating one per frame. Buffers can be
+// grown when frames stop fitting, buffers that are too small get grown as they come back around.
+// Frames can be released from any thread, so the pool is thread safe.
+class Buffer_Pool : public std::enable_shared_from_this<Buffer_Pool> {
+public:
+    using Buffer = std::unique_ptr<std::vector<std::uint8_t>>;
+    Buffer_Pool(std::size_t buffer_size, std::size_t maximum_free_buffers);
+
+    Buffer acquire();  // a buffer of at least the pool's buffer size
+    void release(Buffer buffer);
+
+    // frame borrowing size bytes of buffer from offset on, the buffer comes back to the pool with
+    // the frame
+    Frame_Ptr make_frame(Buffer buffer, std::size_t offset, std::size_t size, Frame::Format format,
+                         std::uint16_t width, std::uint16_t height, Frame::Type type,
+                         Capture_Info capture);
+
+    void grow(std::size_t size);  // buffers handed out from now on are at least size bytes
+    std::size_t get_buffer_size() const;
+
+private:
+    std::vector<Buffer> free_buffers;  // guarded by mutex
+    const std::size_t maximum_free_buffers;
+    std::size_t buffer_size;
+    mutable std::mutex mutex;
+};
+
+#endif
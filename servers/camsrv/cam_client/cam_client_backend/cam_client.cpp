@@ -1,7 +1,13 @@
 #include "cam_client.hpp"
 
+#include <chrono>
 #include <iostream>
 
+#define MAXIMUM_FRAME_AGE_MS 500     // frames older than this are skipped rather than shown
+#define LATENCY_REPORT_FRAMES 300  // frames between reports of the average latency
+#define RESYNC_STALE_FRAMES 30     // frames skipped in a row before the server's clock is trusted
+                                   // to have been set back rather than frames being that late
+
 Cam_Client::Cam_Client(boost::asio::io_service &io_service, Connection_Callback conn_cb,
                        Image_Callback image_cb)
     : io_service(io_service),
@@ -58,10 +64,24 @@ void Cam_Client::start_async_connect() {
 
             start_read();
 
+            // saying hello first gets us whole messages, it's the only one sent as a legacy message
+            camsrv::camsrv_message hm;
+            hm.command = camsrv::camsrv_message::camsrv_command::HELLO;
+
+            // asking for the camera's jpeg as is, the frontend can decode it itself and it saves
+            // the server from decoding and re-encoding every frame as png
+            camsrv::camsrv_message fm;
+            fm.command = camsrv::camsrv_message::camsrv_command::SET_FORMAT;
+            fm.format = camsrv::camsrv_message::camsrv_format::JPEG;
+
             camsrv::camsrv_message cm;
             cm.command = camsrv::camsrv_message::camsrv_command::STREAM_ON;
 
             try {
+                boost::asio::write(socket, boost::asio::buffer(reinterpret_cast<char *>(&hm),
+                                                               camsrv::LEGACY_MESSAGE_SIZE));
+                boost::asio::write(socket,
+                                   boost::asio::buffer(reinterpret_cast<char *>(&fm), sizeof(fm)));
                 boost::asio::write(socket,
                                    boost::asio::buffer(reinterpret_cast<char *>(&cm), sizeof(cm)));
             } catch (const boost::exception &) {
@@ -84,16 +104,27 @@ void Cam_Client::start_read() {
                         boost::asio::buffer_cast<const camsrv::camsrv_message *>(
                             header_buffer.data());
 
-                    switch (cm->command) {
+                    // the header's memory gets reused by the next read
+                    auto header = *cm;
+                    switch (header.command) {
+                        case camsrv::camsrv_message::camsrv_command::HELLO:
+                            // the server answering our hello, nothing to do with it
+                            reset_buffers();
+                            start_read();
+                            break;
                         case camsrv::camsrv_message::camsrv_command::IMAGE:
                             // std::cout << "client: received image" << std::endl;
 
                             boost::asio::async_read(
-                                socket, data_buffer, boost::asio::transfer_exactly(cm->size),
-                                [&, cm](const boost::system::error_code &error,
-                                        std::size_t bytes_transferred) {
+                                socket, data_buffer, boost::asio::transfer_exactly(header.size),
+                                [&, header](const boost::system::error_code &error,
+                                            std::size_t bytes_transferred) {
                                     if (!error) {
-                                        if (bytes_transferred == cm->size) {
+                                        if (bytes_transferred == header.size && is_stale(header)) {
+                                            // still had to be read off the socket to get past it
+                                            reset_buffers();
+                                            start_read();
+                                        } else if (bytes_transferred == header.size) {
                                             // std::cout << "client: received image size of "
                                             // cd           << bytes_transferred << std::endl;
 
@@ -111,7 +142,7 @@ void Cam_Client::start_read() {
                                         } else {
                                             std::cerr << "client: received invalid image size of: "
                                                       << bytes_transferred
-                                                      << ", expected: " << sizeof(cm->size)
+                                                      << ", expected: " << header.size
                                                       << std::endl;
                                             reset();
                                         }
@@ -125,7 +156,7 @@ void Cam_Client::start_read() {
                             break;
                         default:
                             std::cerr << "client: received unknown command: "
-                                      << static_cast<std::uint32_t>(cm->command) << std::endl;
+                                      << static_cast<std::uint32_t>(header.command) << std::endl;
                             reset();
                     }
                 } else {
@@ -141,8 +172,71 @@ void Cam_Client::start_read() {
         });
 }
 
+bool Cam_Client::is_stale(const camsrv::camsrv_message &header) {
+    if (header.timestamp_wall_ns == 0) return false;  // server doesn't stamp its frames
+
+    const std::int64_t maximum_age_ns = static_cast<std::int64_t>(MAXIMUM_FRAME_AGE_MS) * 1000000;
+
+    // frames come in order, anything captured before the last frame shown is out of date. The
+    // server's clock only goes back further than that when it was restarted.
+    if (header.timestamp_monotonic_ns + maximum_age_ns < last_timestamp_ns) {
+        std::cerr << "client: server's clock went back, starting over" << std::endl;
+        reset_clock();
+    } else if (header.timestamp_monotonic_ns <= last_timestamp_ns) {
+        stale_frames++;
+        return true;
+    }
+
+    // the wall clock is the only one we share with a server on another host, but the two hosts'
+    // clocks are never quite the same. The quickest frame so far took next to no time to get here,
+    // so its offset is how far apart the clocks are and frames are measured against it.
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    auto offset = now - header.timestamp_wall_ns;
+    if (!clock_offset_known || offset < clock_offset_ns) {
+        clock_offset_ns = offset;
+        clock_offset_known = true;
+    }
+
+    auto latency = offset - clock_offset_ns;
+    if (latency > maximum_age_ns) {
+        if (++stale_in_a_row < RESYNC_STALE_FRAMES) {
+            if (stale_frames++ % LATENCY_REPORT_FRAMES == 0)
+                std::cerr << "client: skipping frame " << header.sequence << ", it is "
+                          << latency / 1000000 << " ms late (" << stale_frames << " skipped)"
+                          << std::endl;
+            return true;
+        }
+
+        // every frame being late means one of the clocks was set back, not that frames are
+        std::cerr << "client: clocks changed by " << latency / 1000000 << " ms, starting over"
+                  << std::endl;
+        clock_offset_ns = offset;
+        latency = 0;
+    }
+
+    stale_in_a_row = 0;
+    last_timestamp_ns = header.timestamp_monotonic_ns;
+    total_latency_ns += latency;
+    if (++frames_measured % LATENCY_REPORT_FRAMES == 0) {
+        std::cout << "client: frames are " << total_latency_ns / LATENCY_REPORT_FRAMES / 1000
+                  << " us later than the quickest one on average" << std::endl;
+        total_latency_ns = 0;
+    }
+
+    return false;
+}
+
+void Cam_Client::reset_clock() {
+    last_timestamp_ns = 0;
+    clock_offset_known = false;
+    stale_in_a_row = 0;
+}
+
 void Cam_Client::reset() {
     std::cout << "client: resetting socket" << std::endl;
+    reset_clock();  // a new connection may well be to a restarted server
 
     try {
         socket.close();
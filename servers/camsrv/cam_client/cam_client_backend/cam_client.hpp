@@ -25,6 +25,10 @@ private:
     void start_keepalive();
     void updated_connection_status(bool status);
 
+    // frames that are older than one already shown, or too old to be worth showing, are skipped
+    bool is_stale(const camsrv::camsrv_message &header);
+    void reset_clock();  // forgets everything is_stale knows about the server's clocks
+
     boost::asio::streambuf header_buffer;
     boost::asio::streambuf data_buffer;
 
@@ -37,6 +41,15 @@ private:
     Image_Callback image_callback;
 
     bool connection_status = false;
+
+    // how late frames are getting to us, measured from when the camera captured them
+    std::int64_t last_timestamp_ns = 0;  // monotonic capture time of the last frame shown
+    std::int64_t clock_offset_ns = 0;    // our wall clock less the server's, as near as we know
+    bool clock_offset_known = false;
+    std::uint64_t stale_in_a_row = 0;
+    std::uint64_t stale_frames = 0;
+    std::uint64_t frames_measured = 0;
+    std::int64_t total_latency_ns = 0;  // since latency was last reported
 };
 
 #endif
\ No newline at end of file
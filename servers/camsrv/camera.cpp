@@ -3,11 +3,12 @@
 #include "server.hpp"
 
 Camera::Camera(std::shared_ptr<Server> svr, boost::asio::io_service &controller_service,
-               boost::asio::io_service &io_service, std::string dev_name)
+               boost::asio::io_service &io_service, std::string dev_name, std::uint32_t sid)
     : server(svr),
       controller_service(controller_service),
       io_service(io_service),
-      device_name(dev_name) {}
+      device_name(dev_name),
+      stream_id(sid) {}
 
 Camera::~Camera() {}
 
@@ -15,4 +16,6 @@ void Camera::set_stream(bool on) { streaming = on; }
 
 bool Camera::is_streaming() const { return streaming; }
 
-std::string Camera::get_device_name() const { return device_name; }
\ No newline at end of file
+std::string Camera::get_device_name() const { return device_name; }
+
+std::uint32_t Camera::get_stream_id() const { return stream_id; }
\ No newline at end of file
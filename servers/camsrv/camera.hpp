@@ -1,6 +1,9 @@
 #ifndef camera__HPP
 #define camera__HPP
 
+// standard includes
+#include <atomic>
+
 // boost includes
 #include <boost/asio.hpp>
 
@@ -8,14 +11,15 @@ class Server;  // forward declaration
 class Camera {
 public:
     Camera(std::shared_ptr<Server> server, boost::asio::io_service &controller_service,
-           boost::asio::io_service &io_service, std::string device_name);
-    ~Camera();
+           boost::asio::io_service &io_service, std::string device_name, std::uint32_t stream_id);
+    virtual ~Camera();
 
     virtual void set_stream(bool on);
+    bool is_streaming() const;
 
 protected:
     std::string get_device_name() const;
-    bool is_streaming() const;
+    std::uint32_t get_stream_id() const;  // identifies the camera's frames to the server
 
     // services
     boost::asio::io_service &controller_service;  // controller object threads service
@@ -25,7 +29,8 @@ protected:
 
 private:
     std::string device_name;
-    bool streaming = false;
+    const std::uint32_t stream_id;
+    std::atomic<bool> streaming{false};  // may be read from a thread the camera runs for itself
 };
 
 #endif
\ No newline at end of file
@@ -1,21 +1,61 @@
 #ifndef CAMSRV_MSG
 #define CAMSRV_MSG
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
 namespace camsrv {
+// Every connection starts out with legacy messages, only the first LEGACY_MESSAGE_SIZE bytes of a
+// camsrv_message (size, width, height and command), so clients built before the rest was added
+// keep working and get full size png of the first camera. A client that sends HELLO as its first
+// message, itself a legacy message, gets whole messages from then on starting with a HELLO back,
+// and sends whole messages itself.
 struct camsrv_message {
     std::uint32_t size = 0;    // size of image if there is one
-    std::uint16_t width = 0;   // width of image
-    std::uint16_t height = 0;  // height of image
+    std::uint16_t width = 0;   // width of image, or the largest width a client wants (0 is any)
+    std::uint16_t height = 0;  // height of image, or the largest height a client wants (0 is any)
 
     enum struct camsrv_command : std::uint32_t {
         IMAGE = 0,       // what the gui client receives
         KEEP_ALIVE = 1,  // keep alive message
         STREAM_ON = 2,   // enables the stream
         STREAM_OFF = 3,  // disables the stream
+        SET_FORMAT = 4,  // selects the image format the client wants to receive
+        SHM_INFO = 5,    // asks for (and replies with) the shared memory ring name as payload
+        STATS = 6,       // asks for (and replies with) a text report of the server's stats
+        HELLO = 7,       // switches the connection over to whole messages
     } command;
+
+    // everything from here on is only sent once the client has said hello
+
+    enum struct camsrv_format : std::uint32_t {
+        PNG = 0,   // decoded and re-encoded as png, what a client gets unless it asks otherwise
+        JPEG = 1,  // jpeg as the camera sent it, only re-encoded if a smaller size was asked for
+        SHARED_MEMORY = 2,  // frames only go to the shared memory ring, nothing sent over socket
+        BGR = 3,            // uncompressed 8 bit bgr pixels, decoded or converted from the camera
+        YUYV = 4,           // uncompressed yuyv 4:2:2 exactly as the camera sent it
+        NV12 = 5,           // uncompressed nv12 4:2:0 exactly as the camera sent it
+        // compressed video exactly as the camera sent it, one access unit per image as an annex b
+        // byte stream, key frames carry their parameter sets so a client can start on any of them
+        H264 = 6,
+        H265 = 7,
+    } format = camsrv_format::PNG;  // format of the image, or the format a client is requesting
+
+    // camera the message is about, clients follow one camera at a time and pick it with every
+    // command they send
+    std::uint32_t stream_id = 0;
+
+    // set on images, the frame's number within its stream (gaps are frames that never made it to
+    // us, wraps around) and when the camera captured it. The monotonic clock is only comparable on
+    // the host camsrv runs on, use the wall clock anywhere else.
+    std::uint32_t sequence = 0;
+    std::int64_t timestamp_monotonic_ns = 0;  // CLOCK_MONOTONIC
+    std::int64_t timestamp_wall_ns = 0;       // CLOCK_REALTIME
 };
+
+const std::size_t LEGACY_MESSAGE_SIZE = 12;
+static_assert(offsetof(camsrv_message, format) == LEGACY_MESSAGE_SIZE,
+              "legacy clients only know the message up to the command");
 }  // namespace camsrv
 #endif
\ No newline at end of file
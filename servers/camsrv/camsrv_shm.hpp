@@ -0,0 +1,114 @@
+#ifndef CAMSRV_SHM
+#define CAMSRV_SHM
+
+// Layout of the POSIX shared memory frame ring camsrv publishes frames to for clients on the same
+// host. A client finds the ring's name by sending SHM_INFO over the control socket, maps it read
+// only and reads frames straight out of the ring. Every slot is guarded by a seqlock and the
+// ring's publish count doubles as a (process shared) futex word clients can sleep on. Clients never
+// write to the ring, camsrv wakes the futex with every frame whether anybody sleeps on it or not.
+// shm_reader/shm_reader.cpp is a minimal client.
+
+// c includes
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// standard includes
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#include "camsrv_msg.hpp"
+
+namespace camsrv {
+const std::uint32_t SHM_RING_MAGIC = 0x63616d72;  // "camr"
+const std::uint32_t SHM_RING_VERSION = 4;
+
+struct shm_ring_header {
+    std::uint32_t magic;       // SHM_RING_MAGIC once the ring has been initialized
+    std::uint32_t version;     // SHM_RING_VERSION
+    std::uint32_t slot_count;  // number of frame slots following this header
+    std::uint32_t slot_size;   // maximum frame size each slot can hold
+
+    std::atomic<std::uint32_t> publish_count;  // frames published so far (wraps), futex word
+    std::atomic<std::uint64_t> latest;         // frame number of the latest frame, 0 if none
+};
+
+struct shm_slot_header {
+    std::atomic<std::uint32_t> sequence;  // seqlock, odd while the slot is being written
+    std::uint32_t size;                   // size of the frame in this slot
+    std::uint64_t frame_number;           // frame number of the frame in this slot
+    camsrv_message::camsrv_format format;
+    std::uint16_t width;   // only set for uncompressed formats
+    std::uint16_t height;  // only set for uncompressed formats
+
+    // when and in what order the camera captured the frame, see camsrv_message
+    std::uint64_t capture_sequence;
+    std::int64_t capture_monotonic_ns;
+    std::int64_t capture_wall_ns;
+};
+
+static_assert(sizeof(shm_ring_header) <= 64, "ring header must fit before the first slot");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared memory ring needs address free atomics");
+
+// size of a whole ring, every slot starts on a cache line of its own
+inline std::size_t shm_slot_stride(std::uint32_t slot_size) {
+    return (sizeof(shm_slot_header) + slot_size + 63) & ~static_cast<std::size_t>(63);
+}
+
+inline std::size_t shm_ring_size(std::uint32_t slot_count, std::uint32_t slot_size) {
+    return 64 + shm_slot_stride(slot_size) * slot_count;
+}
+
+inline const shm_slot_header *shm_slot(const shm_ring_header *ring,
+                                       std::uint64_t frame_number) {
+    auto base = reinterpret_cast<const std::uint8_t *>(ring) + 64;
+    auto index = frame_number % ring->slot_count;
+    return reinterpret_cast<const shm_slot_header *>(base +
+                                                     index * shm_slot_stride(ring->slot_size));
+}
+
+inline shm_slot_header *shm_slot(shm_ring_header *ring, std::uint64_t frame_number) {
+    return const_cast<shm_slot_header *>(
+        shm_slot(static_cast<const shm_ring_header *>(ring), frame_number));
+}
+
+inline const std::uint8_t *shm_slot_data(const shm_slot_header *slot) {
+    return reinterpret_cast<const std::uint8_t *>(slot) + sizeof(shm_slot_header);
+}
+
+// Sleeps until a frame newer than seen_count is published or timeout_ms passes. seen_count is the
+// ring's publish_count the last time the caller looked. Only reads the ring.
+inline void shm_wait(const shm_ring_header *ring, std::uint32_t seen_count, long timeout_ms) {
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+
+    // the kernel checks the count hasn't moved on before sleeping, so no wake up gets lost
+    syscall(SYS_futex, reinterpret_cast<const std::uint32_t *>(&ring->publish_count), FUTEX_WAIT,
+            seen_count, &ts, nullptr, 0);
+}
+
+// Hands the latest frame to reader straight out of shared memory, reader gets (data, slot header)
+// and finds the frame's size, format and such in the header. Returns false if there is no frame
+// yet, or if camsrv overwrote the slot while the reader was looking at it, in which case whatever
+// the reader did with the data must be thrown away.
+template <typename Reader>
+bool shm_read_latest(const shm_ring_header *ring, Reader reader) {
+    auto frame_number = ring->latest.load(std::memory_order_acquire);
+    if (frame_number == 0) return false;
+
+    auto slot = shm_slot(ring, frame_number);
+    auto before = slot->sequence.load(std::memory_order_acquire);
+    if ((before & 1) || slot->frame_number != frame_number) return false;
+
+    reader(shm_slot_data(slot), static_cast<const shm_slot_header &>(*slot));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == before;
+}
+}  // namespace camsrv
+#endif
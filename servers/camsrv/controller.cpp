@@ -1,28 +1,71 @@
 #include "controller.hpp"
 
+#include <algorithm>
 #include <iostream>
 
-Controller::Controller(std::string device_name, std::uint16_t port, std::string url,
+Controller::Controller(std::uint16_t port, camsrv::controller_options_type &controller_options,
                        boost::asio::io_service &io_service)
     : io_service(io_service), timer(io_service) {
-    server = std::make_shared<Server>(io_service, port, [&](bool stream) {
-        if (camera) camera_service.post(std::bind(&Camera::set_stream, std::ref(camera), stream));
-    });
-    camera_thread = std::thread(std::bind(&Controller::worker_thread, this, device_name, url));
+    // every camera gets a ring of its own, only numbered when there's more than one
+    auto stream_count = controller_options.device_names.size() + controller_options.urls.size();
+    std::vector<std::unique_ptr<Shm_Ring>> shm_rings(stream_count);
+    for (std::size_t i = 0; i < stream_count && !controller_options.shm_name.empty(); i++) {
+        auto name = controller_options.shm_name;
+        if (stream_count > 1) name += "_" + std::to_string(i);
+        shm_rings.at(i) = std::make_unique<Shm_Ring>(name, camsrv::SHM_RING_SLOT_COUNT,
+                                                     camsrv::SHM_RING_SLOT_SIZE);
+    }
+
+    // one pending frame per stream and target, with room for every stream to be encoded into as
+    // many targets at once as there are encoder threads. Anything more would only be sent late.
+    auto encode_queue_size =
+        std::max<std::size_t>(stream_count, 1) * controller_options.encoder_threads;
+    encoder_pool = std::make_shared<Encoder_Pool>(io_service, controller_options.encoder_threads,
+                                                  encode_queue_size);
+
+    // cameras only live on the camera thread, so that's where stream changes get handled
+    server = std::make_shared<Server>(
+        io_service, port, encoder_pool, std::move(shm_rings),
+        [&](std::uint32_t stream_id, bool stream) {
+            camera_service.post([this, stream_id, stream]() {
+                if (stream_id < cameras.size()) cameras.at(stream_id)->set_stream(stream);
+            });
+        },
+        controller_options.stats_interval);
+    camera_thread =
+        std::thread(std::bind(&Controller::worker_thread, this, controller_options));
 }
 
 Controller::~Controller() {
+    camera_service.stop();  // camera's service would otherwise keep running forever
     camera_thread.join();
-    camera_service.stop();
+
+    // ip cameras can only be torn down once live555 has stopped
+    if (rtsp_loop) rtsp_loop->stop();
+    cameras.clear();
+    rtsp_loop.reset();
 }
 
-void Controller::worker_thread(std::string device_name, std::string url) {
-    bool use_url_node = !url.empty();
+void Controller::worker_thread(camsrv::controller_options_type controller_options) {
+    // stream ids are handed out to webcameras first, then ip cameras, in the order they were given
+    std::uint32_t stream_id = 0;
+    for (const auto &d : controller_options.device_names) {
+        std::cout << "controller: stream " << stream_id << " is " << d << std::endl;
+        cameras.push_back(std::make_shared<WebCamera>(server, io_service, camera_service, d,
+                                                      controller_options.capture, stream_id++));
+    }
 
-    if (use_url_node)
-        camera = std::make_unique<IPCamera>(server, io_service, camera_service, url);
-    else
-        camera = std::make_unique<WebCamera>(server, io_service, camera_service, device_name);
+    // every ip camera shares a single live555 loop
+    if (!controller_options.urls.empty()) {
+        rtsp_loop = std::make_unique<Rtsp_Loop>();
+        for (const auto &u : controller_options.urls) {
+            std::cout << "controller: stream " << stream_id << " is " << u << std::endl;
+            cameras.push_back(std::make_shared<IPCamera>(server, io_service, camera_service, u,
+                                                         stream_id++, controller_options.rtsp,
+                                                         *rtsp_loop));
+        }
+        rtsp_loop->start();
+    }
 
     // Avoids race condition. What if somehow the server has already been connected and sent a
     // stream on/off command. Our camera object in a different thread may not have been
@@ -35,4 +78,4 @@ void Controller::worker_thread(std::string device_name, std::string url) {
     boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard(
         camera_service.get_executor());
     camera_service.run();
-}
\ No newline at end of file
+}
@@ -4,32 +4,38 @@
 // standard includes
 #include <string>
 #include <thread>
+#include <vector>
 
 // boost includes
 #include <boost/asio.hpp>
 
 #include "camera.hpp"
+#include "defines.hpp"
+#include "encoder_pool.hpp"
 #include "ipcamera.hpp"
+#include "rtsp_loop.hpp"
 #include "server.hpp"
 #include "webcamera.hpp"
 
 class Controller {
 public:
-    Controller(std::string device_name, std::uint16_t port, std::string url,
+    Controller(std::uint16_t port, camsrv::controller_options_type &controller_options,
                boost::asio::io_service &io_service);
     ~Controller();
 
 private:
-    void worker_thread(std::string device_name, std::string url);
+    void worker_thread(camsrv::controller_options_type controller_options);
 
     // asio services
     boost::asio::io_service camera_service;
     boost::asio::io_service &io_service;
 
-    // camera
-    std::unique_ptr<Camera> camera;
+    // cameras, indexed by stream id and only touched from the camera thread
+    std::vector<std::shared_ptr<Camera>> cameras;  // shared so frames can tell once one is gone
+    std::unique_ptr<Rtsp_Loop> rtsp_loop;  // shared by every ip camera, null if there are none
     std::thread camera_thread;
 
+    std::shared_ptr<Encoder_Pool> encoder_pool;
     std::shared_ptr<Server> server;
 
     boost::asio::steady_timer timer;  // keep-alive timer
@@ -0,0 +1,158 @@
+#include "decoder.hpp"
+
+// standard includes
+#include <iostream>
+#include <utility>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+// opencv include
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#define MAXIMUM_SCALE_DENOMINATOR 8  // libjpeg can't scale down any further than 1/8 while decoding
+
+Decoder::Decoder() {
+#ifdef CAMSRV_USE_TURBOJPEG
+    handle = tjInitDecompress();
+    if (!handle)
+        std::cerr << "decoder: couldn't create turbojpeg decompressor, using opencv" << std::endl;
+#endif
+}
+
+Decoder::~Decoder() {
+#ifdef CAMSRV_USE_TURBOJPEG
+    if (handle) tjDestroy(handle);
+#endif
+}
+
+const cv::Mat &Decoder::decode(const Frame &frame, std::uint16_t max_width,
+                               std::uint16_t max_height) {
+    bool decoded = false;
+    switch (frame.format()) {
+        case Frame::Format::JPEG:
+#ifdef CAMSRV_USE_TURBOJPEG
+            if (handle && turbo_decode(frame, max_width, max_height)) return image;
+#endif
+            decoded = opencv_decode(frame, max_width, max_height);
+            break;
+        case Frame::Format::YUYV:
+        case Frame::Format::NV12:
+        case Frame::Format::BGR:
+            decoded = convert(frame, max_width, max_height);
+            break;
+        default:
+            SLOG_ERROR("decoder", "can't decode frame format",
+                       slog::field("format", static_cast<std::uint32_t>(frame.format())));
+            break;
+    }
+
+    if (!decoded) image = cv::Mat();
+    return image;
+}
+
+int Decoder::scale_denominator(int width, int height, std::uint16_t max_width,
+                               std::uint16_t max_height) {
+    int denominator = 1;
+    while (denominator < MAXIMUM_SCALE_DENOMINATOR &&
+           ((max_width && width / denominator > max_width) ||
+            (max_height && height / denominator > max_height)))
+        denominator *= 2;
+
+    return denominator;
+}
+
+#ifdef CAMSRV_USE_TURBOJPEG
+bool Decoder::turbo_decode(const Frame &frame, std::uint16_t max_width,
+                           std::uint16_t max_height) {
+    int width, height, subsampling, colorspace;
+    if (tjDecompressHeader3(handle, frame.data(), frame.size(), &width, &height, &subsampling,
+                            &colorspace) != 0) {
+        SLOG_ERROR("decoder", "turbojpeg couldn't read header",
+                   slog::field("error", tjGetErrorStr2(handle)));
+        return false;
+    }
+
+    // scaling happens in the dct domain, so a smaller image is cheaper to decode than a full one
+    tjscalingfactor scale = {1, scale_denominator(width, height, max_width, max_height)};
+    auto scaled_width = TJSCALED(width, scale);
+    auto scaled_height = TJSCALED(height, scale);
+
+    image.create(scaled_height, scaled_width, CV_8UC3);
+    if (tjDecompress2(handle, frame.data(), frame.size(), image.data, scaled_width,
+                      static_cast<int>(image.step), scaled_height, TJPF_BGR,
+                      TJFLAG_FASTDCT) != 0) {
+        SLOG_ERROR("decoder", "turbojpeg couldn't decode frame", slog::field("size", frame.size()),
+                   slog::field("error", tjGetErrorStr2(handle)));
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+bool Decoder::opencv_decode(const Frame &frame, std::uint16_t max_width,
+                            std::uint16_t max_height) {
+    // decoding straight out of the frame's memory without copying it
+    cv::Mat mjpeg(1, static_cast<int>(frame.size()), CV_8UC1,
+                  const_cast<std::uint8_t *>(frame.data()));
+    if (!max_width && !max_height) {
+        cv::imdecode(mjpeg, cv::IMREAD_COLOR, &image);
+        return !image.empty();
+    }
+
+    cv::imdecode(mjpeg, cv::IMREAD_COLOR, &full_image);
+    if (full_image.empty()) return false;
+
+    scale_full_image(max_width, max_height);
+    return true;
+}
+
+bool Decoder::convert(const Frame &frame, std::uint16_t max_width, std::uint16_t max_height) {
+    // wrapping the camera's memory without copying it, opencv's conversions are vectorized
+    int width = frame.width(), height = frame.height();
+    cv::Mat raw;
+    int code;
+    if (frame.format() == Frame::Format::BGR) {
+        raw = cv::Mat(height, width, CV_8UC3, const_cast<std::uint8_t *>(frame.data()));
+        code = -1;  // nothing to convert, only a copy to make
+    } else if (frame.format() == Frame::Format::YUYV) {
+        raw = cv::Mat(height, width, CV_8UC2, const_cast<std::uint8_t *>(frame.data()));
+        code = cv::COLOR_YUV2BGR_YUYV;
+    } else {
+        raw = cv::Mat(height * 3 / 2, width, CV_8UC1, const_cast<std::uint8_t *>(frame.data()));
+        code = cv::COLOR_YUV2BGR_NV12;
+    }
+
+    if (raw.total() * raw.elemSize() > frame.size()) {
+        SLOG_ERROR("decoder", "frame is too short for its size", slog::field("size", frame.size()),
+                   slog::field("width", width), slog::field("height", height));
+        return false;
+    }
+
+    if (code < 0)
+        raw.copyTo(full_image);  // image has to outlive the frame's memory
+    else if (!max_width && !max_height) {
+        cv::cvtColor(raw, image, code);
+        return true;
+    } else
+        cv::cvtColor(raw, full_image, code);
+
+    scale_full_image(max_width, max_height);
+    return true;
+}
+
+void Decoder::scale_full_image(std::uint16_t max_width, std::uint16_t max_height) {
+    // scaling the same way turbojpeg would, so output doesn't depend on which decoder was used
+    auto denominator = scale_denominator(full_image.cols, full_image.rows, max_width, max_height);
+    if (denominator == 1) {
+        std::swap(image, full_image);
+        return;
+    }
+
+    cv::resize(full_image, image,
+               cv::Size((full_image.cols + denominator - 1) / denominator,
+                        (full_image.rows + denominator - 1) / denominator),
+               0, 0, cv::INTER_AREA);
+}
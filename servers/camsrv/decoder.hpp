@@ -0,0 +1,53 @@
+#ifndef decoder__HPP
+#define decoder__HPP
+
+// standard includes
+#include <cstdint>
+
+// opencv include
+#include <opencv2/core.hpp>
+
+#ifdef CAMSRV_USE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#include "frame.hpp"
+
+// Decodes jpeg frames, or converts yuyv and nv12 frames, into bgr images, bgr frames (decoded
+// video) only get scaled. Built with libjpeg-turbo the decompressor is created once and reused for
+// every frame, and jpeg frames that only need to fit a smaller size are scaled down by 1/2, 1/4 or
+// 1/8 while decoding, which costs a fraction of a full decode. Without libjpeg-turbo, or if it
+// fails on a frame, opencv's decoder is used instead. A decoder is not thread safe, every encoder
+// thread has its own.
+class Decoder {
+public:
+    Decoder();
+    ~Decoder();
+
+    Decoder(const Decoder &) = delete;
+    Decoder &operator=(const Decoder &) = delete;
+
+    // decodes frame so it fits within max width and height (0 means any size), the image returned
+    // is reused by the next call to decode, returns an empty image on failure
+    const cv::Mat &decode(const Frame &frame, std::uint16_t max_width, std::uint16_t max_height);
+
+private:
+    // largest power of two (up to 8) an image has to be divided by to fit within max width/height
+    static int scale_denominator(int width, int height, std::uint16_t max_width,
+                                 std::uint16_t max_height);
+
+#ifdef CAMSRV_USE_TURBOJPEG
+    bool turbo_decode(const Frame &frame, std::uint16_t max_width, std::uint16_t max_height);
+
+    tjhandle handle = nullptr;
+#endif
+    bool opencv_decode(const Frame &frame, std::uint16_t max_width, std::uint16_t max_height);
+    bool convert(const Frame &frame, std::uint16_t max_width, std::uint16_t max_height);
+    void scale_full_image(std::uint16_t max_width, std::uint16_t max_height);  // into image
+
+    // output images, only reallocated when the frame size changes
+    cv::Mat image;
+    cv::Mat full_image;  // only used when an image needs scaling after decoding
+};
+
+#endif
@@ -1,13 +1,90 @@
 #ifndef camsrv_DEFINES__HPP
 #define camsrv_DEFINES__HPP
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace camsrv {
 const std::string CAMSRV_APPLICATION_NAME = "camsrv";
 const std::string CAMSRV_VERSION_NUMBER = CAMSRV_APPLICATION_NAME + " 4.0.0";  // version number
 const std::string CAMSRV_APPLICATION_DESCRIPTION =
     "camera server which feeds webcam images from remote cpu";  // application description
+
+// number of memory mapped buffers requested from a v4l2 device, more buffers lets the driver keep
+// capturing while we're still busy with earlier frames
+const std::uint32_t DEFAULT_CAPTURE_BUFFER_COUNT = 4;
+const std::uint32_t MINIMUM_CAPTURE_BUFFER_COUNT = 2;
+const std::uint32_t MAXIMUM_CAPTURE_BUFFER_COUNT = 32;
+
+// what a webcamera is asked to capture by default, the closest the device supports gets used
+const std::uint32_t DEFAULT_CAPTURE_WIDTH = 320;
+const std::uint32_t DEFAULT_CAPTURE_HEIGHT = 240;
+const std::uint32_t DEFAULT_CAPTURE_FPS = 30;
+const std::uint32_t MAXIMUM_CAPTURE_FPS = 240;
+
+// threads used to re-encode frames for clients that want a different format than the camera's
+const std::uint32_t DEFAULT_ENCODER_THREAD_COUNT = 2;
+const std::uint32_t MINIMUM_ENCODER_THREAD_COUNT = 1;
+const std::uint32_t MAXIMUM_ENCODER_THREAD_COUNT = 16;
+
+// ip camera frames are received straight into pooled buffers, those start out sized for the
+// stream and grow whenever a frame doesn't fit
+const std::size_t MINIMUM_RTSP_BUFFER_SIZE = 100000;
+const std::size_t MAXIMUM_RTSP_BUFFER_SIZE = 32 * 1024 * 1024;
+const std::size_t MAXIMUM_FREE_RTSP_BUFFERS = 8;  // buffers kept around for reuse
+
+// ip cameras whose stream ends get reconnected, backing off (with jitter) up to the maximum delay
+const std::uint32_t MINIMUM_RTSP_RECONNECT_DELAY_MS = 500;
+const std::uint32_t MAXIMUM_RTSP_RECONNECT_DELAY_MS = 30000;
+// a stream that sends nothing for this long has ended even if it never said so (e.g. a lost bye)
+const std::uint32_t RTSP_STREAM_TIMEOUT_SECONDS = 10;
+const std::uint16_t DEFAULT_RTSP_HTTP_PORT = 80;
+// an ip camera nobody is streaming gets paused, and torn down if it stays that way for this long
+const std::uint32_t RTSP_IDLE_TEARDOWN_SECONDS = 60;
+
+// compressed video frames waiting on a client or decoder before frames start getting dropped
+const std::size_t VIDEO_QUEUE_SIZE = 30;
+
+// longest a stats line can be printed apart, 0 only reports stats when a client asks for them
+const std::uint32_t MAXIMUM_STATS_INTERVAL_SECONDS = 3600;
+
+// number of cameras a single server can host
+const std::size_t MAXIMUM_STREAMS = 8;
+
+// number of clients allowed to be connected to the server at once
+const std::size_t MAXIMUM_SUBSCRIBERS = 8;
+
+// shared memory ring local clients can read frames from, a slot has to fit the largest frame
+const std::uint32_t SHM_RING_SLOT_COUNT = 4;
+const std::uint32_t SHM_RING_SLOT_SIZE = 8 * 1024 * 1024;
+
+struct capture_options_type {
+    std::string pixel_format;  // mjpeg, yuyv or nv12, empty picks the first one the device supports
+    std::uint32_t width = DEFAULT_CAPTURE_WIDTH;
+    std::uint32_t height = DEFAULT_CAPTURE_HEIGHT;
+    std::uint32_t fps = DEFAULT_CAPTURE_FPS;
+    std::uint32_t buffer_count = DEFAULT_CAPTURE_BUFFER_COUNT;  // memory mapped capture buffers
+};
+
+// how rtp gets from an ip camera to us, tcp and http get through firewalls and never lose packets
+// but cost more than udp
+enum class rtsp_transport_type { UDP, TCP, HTTP };
+
+struct rtsp_options_type {
+    rtsp_transport_type transport = rtsp_transport_type::UDP;
+    std::uint16_t http_port = DEFAULT_RTSP_HTTP_PORT;  // only used when tunneling over http
+};
+
+struct controller_options_type {
+    std::vector<std::string> device_names;  // device names/paths of webcameras
+    std::vector<std::string> urls;          // rtsp urls of ip cameras
+    capture_options_type capture;           // only used by webcameras
+    rtsp_options_type rtsp;                 // only used by ip cameras
+    std::uint32_t encoder_threads = DEFAULT_ENCODER_THREAD_COUNT;  // threads re-encoding frames
+    std::string shm_name;  // shared memory ring for local clients, disabled if empty
+    std::uint32_t stats_interval = 0;  // seconds between stats lines, disabled if 0
+};
 }  // namespace camsrv
 
 #endif
\ No newline at end of file
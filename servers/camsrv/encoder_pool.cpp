@@ -0,0 +1,139 @@
+#include "encoder_pool.hpp"
+
+// standard includes
+#include <algorithm>
+#include <iostream>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+// opencv include
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+Encoder_Pool::Encoder_Pool(boost::asio::io_service &io_service, std::size_t thread_count,
+                           std::size_t qs)
+    : io_service(io_service), queue_size(qs) {
+    assert(thread_count > 0 && queue_size > 0);  // sanity check
+    for (std::size_t i = 0; i < thread_count; i++) {
+        stats.push_back(std::make_unique<worker_stats>());
+        workers.emplace_back(
+            std::bind(&Encoder_Pool::worker_thread, this, std::ref(*stats.back())));
+    }
+}
+
+Encoder_Pool::~Encoder_Pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto &w : workers) w.join();
+}
+
+void Encoder_Pool::encode(std::uint32_t stream_id, Frame_Ptr frame, Encode_Target target,
+                          Encode_Callback callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // nobody has gotten around to this stream's last frame yet, the newer one takes its place
+        // in the queue so a busy stream can't push anyone else's frames out
+        auto pending = std::find_if(jobs.begin(), jobs.end(), [&](const encode_job &job) {
+            return job.stream_id == stream_id && job.target == target;
+        });
+        if (pending != jobs.end()) {
+            pending->frame = std::move(frame);
+            pending->callback = std::move(callback);
+            pending->queued_ns = Histogram::now_ns();
+            frames_dropped++;
+            return;  // a worker is already waiting for this job
+        }
+
+        // more streams and targets than we have room for, the oldest frame is the least useful
+        if (jobs.size() >= queue_size) {
+            jobs.pop_front();
+            frames_dropped++;
+        }
+
+        jobs.push_back(
+            {stream_id, std::move(frame), target, std::move(callback), Histogram::now_ns()});
+    }
+    condition.notify_one();
+}
+
+void Encoder_Pool::worker_thread(worker_stats &stats) {
+    Decoder decoder;  // decoders keep their buffers between frames, so every thread has its own
+
+    while (true) {
+        encode_job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return stopping || !jobs.empty(); });
+            if (stopping) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        stats.queue_wait.record_since(job.queued_ns);
+
+        auto encoded = transcode(decoder, *job.frame, job.target, stats);
+        job.frame.reset();  // source frame may be holding on to device memory, let it go early
+
+        io_service.post(std::bind(std::move(job.callback), std::move(encoded)));
+    }
+}
+
+Frame_Ptr Encoder_Pool::transcode(Decoder &decoder, const Frame &frame,
+                                  const Encode_Target &target, worker_stats &stats) {
+    auto start = Histogram::now_ns();
+    const auto &decoded_image = decoder.decode(frame, target.max_width, target.max_height);
+    stats.decode.record_since(start);
+    if (decoded_image.empty()) {
+        SLOG_ERROR("encoder", "failed to decode frame", slog::field("size", frame.size()));
+        return nullptr;
+    }
+
+    start = Histogram::now_ns();
+    std::vector<std::uint8_t> encoded_image;
+    switch (target.format) {
+        case camsrv::camsrv_message::camsrv_format::PNG:
+            cv::imencode(".png", decoded_image, encoded_image);
+            break;
+        case camsrv::camsrv_message::camsrv_format::JPEG:
+            cv::imencode(".jpg", decoded_image, encoded_image);
+            break;
+        case camsrv::camsrv_message::camsrv_format::BGR: {
+            // decoder output is always continuous, so the pixels can be taken as they are
+            auto bytes = decoded_image.total() * decoded_image.elemSize();
+            encoded_image.assign(decoded_image.data, decoded_image.data + bytes);
+            break;
+        }
+        default:
+            SLOG_ERROR("encoder", "asked to encode unknown format",
+                       slog::field("format", static_cast<std::uint32_t>(target.format)));
+            return nullptr;
+    }
+
+    stats.encode.record_since(start);
+    stats.bytes_in.fetch_add(frame.size(), std::memory_order_relaxed);
+    stats.bytes_out.fetch_add(encoded_image.size(), std::memory_order_relaxed);
+
+    return std::make_shared<const Frame>(std::move(encoded_image), target.format,
+                                         static_cast<std::uint16_t>(decoded_image.cols),
+                                         static_cast<std::uint16_t>(decoded_image.rows),
+                                         Frame::Type::KEY, frame.capture());
+}
+
+std::uint64_t Encoder_Pool::get_frames_dropped() const { return frames_dropped; }
+
+void Encoder_Pool::add_stats(Stats_Snapshot &snapshot) const {
+    for (const auto &s : stats) {
+        s->queue_wait.add_to(snapshot.queue_wait);
+        s->decode.add_to(snapshot.decode);
+        s->encode.add_to(snapshot.encode);
+        snapshot.encoder_bytes_in += s->bytes_in.load(std::memory_order_relaxed);
+        snapshot.encoder_bytes_out += s->bytes_out.load(std::memory_order_relaxed);
+    }
+    snapshot.frames_dropped += frames_dropped;
+}
@@ -0,0 +1,95 @@
+#ifndef encoder_pool__HPP
+#define encoder_pool__HPP
+
+// standard includes
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// boost includes
+#include <boost/asio.hpp>
+
+#include "camsrv_msg.hpp"
+#include "decoder.hpp"
+#include "frame.hpp"
+#include "stats.hpp"
+
+// what a frame gets encoded into, frames are scaled down to fit within max width and height (0
+// means any size)
+struct Encode_Target {
+    camsrv::camsrv_message::camsrv_format format = camsrv::camsrv_message::camsrv_format::PNG;
+    std::uint16_t max_width = 0;
+    std::uint16_t max_height = 0;
+
+    bool operator<(const Encode_Target &other) const {
+        return std::tie(format, max_width, max_height) <
+               std::tie(other.format, other.max_width, other.max_height);
+    }
+    bool operator==(const Encode_Target &other) const {
+        return std::tie(format, max_width, max_height) ==
+               std::tie(other.format, other.max_width, other.max_height);
+    }
+};
+
+// Decodes and re-encodes frames for clients that can't take the camera's format as is. Encoding is
+// done on a fixed number of threads so the server's event loop never waits on it. Only the latest
+// frames are worth encoding, so a new frame replaces whatever frame of the same stream is still
+// waiting to be encoded into the same target. The oldest pending frame only gets dropped when
+// more streams and targets are waiting than the queue has room for.
+class Encoder_Pool {
+public:
+    // called on the io service with the encoded frame, or nullptr if the frame couldn't be encoded
+    using Encode_Callback = std::function<void(Frame_Ptr)>;
+    Encoder_Pool(boost::asio::io_service &io_service, std::size_t thread_count,
+                 std::size_t queue_size);
+    ~Encoder_Pool();
+
+    void encode(std::uint32_t stream_id, Frame_Ptr frame, Encode_Target target,
+                Encode_Callback callback);
+
+    std::uint64_t get_frames_dropped() const;
+    void add_stats(Stats_Snapshot &snapshot) const;  // what every worker has measured so far
+
+private:
+    struct encode_job {
+        std::uint32_t stream_id = 0;
+        Frame_Ptr frame;
+        Encode_Target target;
+        Encode_Callback callback;
+        std::int64_t queued_ns = 0;  // when the job was handed to us
+    };
+
+    // every worker records into its own, so workers never share a cache line while recording
+    struct worker_stats {
+        Histogram queue_wait;
+        Histogram decode;
+        Histogram encode;
+        std::atomic<std::uint64_t> bytes_in{0};   // of frames that were encoded
+        std::atomic<std::uint64_t> bytes_out{0};  // of what they were encoded into
+    };
+
+    void worker_thread(worker_stats &stats);
+    static Frame_Ptr transcode(Decoder &decoder, const Frame &frame, const Encode_Target &target,
+                               worker_stats &stats);
+
+    boost::asio::io_service &io_service;  // service our results get posted back to
+
+    // pending frames, guarded by mutex
+    std::deque<encode_job> jobs;
+    const std::size_t queue_size;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<worker_stats>> stats;  // one per worker
+
+    std::atomic<std::uint64_t> frames_dropped{0};  // frames replaced before anyone encoded them
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "frame.hpp"
+
+// c includes
+#include <time.h>
+
+namespace {
+std::int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+}  // namespace
+
+Capture_Info Capture_Info::from_monotonic(std::uint64_t sequence, std::int64_t monotonic_ns) {
+    auto age = clock_ns(CLOCK_MONOTONIC) - monotonic_ns;
+    return {sequence, monotonic_ns, clock_ns(CLOCK_REALTIME) - age};
+}
+
+Capture_Info Capture_Info::now(std::uint64_t sequence) {
+    return {sequence, clock_ns(CLOCK_MONOTONIC), clock_ns(CLOCK_REALTIME)};
+}
+
+Frame::Frame(const std::uint8_t *data, std::size_t size, Release_Callback callback, Format format,
+             std::uint16_t width, std::uint16_t height, Type type, Capture_Info capture)
+    : frame_data(data),
+      frame_size(size),
+      frame_format(format),
+      frame_width(width),
+      frame_height(height),
+      frame_type(type),
+      frame_capture(capture),
+      release_callback{callback} {}
+
+Frame::Frame(std::vector<std::uint8_t> data, Format format, std::uint16_t width,
+             std::uint16_t height, Type type, Capture_Info capture)
+    : owned_data(std::move(data)),
+      frame_data(owned_data.data()),
+      frame_size(owned_data.size()),
+      frame_format(format),
+      frame_width(width),
+      frame_height(height),
+      frame_type(type),
+      frame_capture(capture) {}
+
+Frame::~Frame() {
+    if (release_callback) release_callback();  // giving borrowed memory back to its owner
+}
+
+const std::uint8_t *Frame::data() const { return frame_data; }
+
+std::size_t Frame::size() const { return frame_size; }
+
+Frame::Format Frame::format() const { return frame_format; }
+
+std::uint16_t Frame::width() const { return frame_width; }
+
+std::uint16_t Frame::height() const { return frame_height; }
+
+Frame::Type Frame::type() const { return frame_type; }
+
+const Capture_Info &Frame::capture() const { return frame_capture; }
+
+bool Frame::is_video(Format format) { return format == Format::H264 || format == Format::H265; }
@@ -0,0 +1,75 @@
+#ifndef frame__HPP
+#define frame__HPP
+
+// standard includes
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "camsrv_msg.hpp"
+
+// When and in what order a camera captured a frame. Frames decoded or encoded from a frame keep its
+// capture info, so clients can tell how old whatever they're showing is.
+struct Capture_Info {
+    std::uint64_t sequence = 0;     // counts up by one per frame captured, gaps are lost frames
+    std::int64_t monotonic_ns = 0;  // CLOCK_MONOTONIC, only comparable on the same host
+    std::int64_t wall_ns = 0;       // CLOCK_REALTIME
+
+    // filling in the clock the camera didn't give us, going by how far apart the clocks are now
+    static Capture_Info from_monotonic(std::uint64_t sequence, std::int64_t monotonic_ns);
+    static Capture_Info now(std::uint64_t sequence);
+};
+
+// A frame handed from a camera to the server. A frame either owns its bytes or borrows them
+// straight out of the capture device's memory, in which case the release callback is used to hand
+// that memory back to the device once the last reference to the frame has been dropped. Compressed
+// frames that don't know their size have a width and height of 0.
+class Frame {
+public:
+    using Release_Callback = std::function<void()>;
+    using Format = camsrv::camsrv_message::camsrv_format;
+
+    // how a frame depends on the frames around it, anything but compressed video is a key frame.
+    // Nothing refers back to a disposable frame, so skipping one doesn't break the frames after it.
+    enum class Type { KEY, PREDICTED, DISPOSABLE };
+
+    Frame(const std::uint8_t *data, std::size_t size, Release_Callback callback,
+          Format format = Format::JPEG, std::uint16_t width = 0, std::uint16_t height = 0,
+          Type type = Type::KEY, Capture_Info capture = {});
+    explicit Frame(std::vector<std::uint8_t> data, Format format = Format::JPEG,
+                   std::uint16_t width = 0, std::uint16_t height = 0, Type type = Type::KEY,
+                   Capture_Info capture = {});
+    ~Frame();
+
+    // frames are shared by reference, never copied
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+    const std::uint8_t *data() const;
+    std::size_t size() const;
+    Format format() const;
+    std::uint16_t width() const;
+    std::uint16_t height() const;
+    Type type() const;
+    const Capture_Info &capture() const;
+
+    // compressed video frames can only be decoded in order, starting from a key frame
+    static bool is_video(Format format);
+
+private:
+    std::vector<std::uint8_t> owned_data;  // only used when the frame owns its bytes
+    const std::uint8_t *frame_data;
+    std::size_t frame_size;
+    Format frame_format;
+    std::uint16_t frame_width;
+    std::uint16_t frame_height;
+    Type frame_type;
+    Capture_Info frame_capture;
+
+    Release_Callback release_callback;
+};
+
+using Frame_Ptr = std::shared_ptr<const Frame>;
+
+#endif
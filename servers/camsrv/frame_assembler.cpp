@@ -0,0 +1,156 @@
+#include "frame_assembler.hpp"
+
+// standard includes
+#include <algorithm>
+#include <cstring>
+
+#include "defines.hpp"
+
+namespace {
+const std::uint8_t START_CODE[] = {0, 0, 0, 1};
+
+// h.264 nal unit types, see table 7-1 of the spec
+const std::uint8_t H264_NAL_SLICE = 1;
+const std::uint8_t H264_NAL_IDR = 5;
+const std::uint8_t H264_NAL_SPS = 7;
+const std::uint8_t H264_NAL_PPS = 8;
+
+// h.265 nal unit types, see table 7-1 of the spec
+const std::uint8_t H265_NAL_RESERVED_VCL_N14 = 14;  // last of the sub-layer non-reference types
+const std::uint8_t H265_NAL_BLA_W_LP = 16;          // first of the irap types
+const std::uint8_t H265_NAL_RESERVED_IRAP_23 = 23;  // last of the irap types
+const std::uint8_t H265_NAL_RESERVED_VCL_31 = 31;   // last of the vcl types
+const std::uint8_t H265_NAL_VPS = 32;
+const std::uint8_t H265_NAL_PPS = 34;
+}  // namespace
+
+Frame_Assembler::Frame_Assembler(Frame::Format f, std::vector<std::uint8_t> ps, std::uint16_t w,
+                                 std::uint16_t h, std::size_t buffer_size)
+    : format(f), parameter_sets(std::move(ps)), width(w), height(h) {
+    buffer_size = std::min(std::max(buffer_size, camsrv::MINIMUM_RTSP_BUFFER_SIZE),
+                           camsrv::MAXIMUM_RTSP_BUFFER_SIZE);
+    buffer_pool = std::make_shared<Buffer_Pool>(buffer_size, camsrv::MAXIMUM_FREE_RTSP_BUFFERS);
+}
+
+std::uint8_t *Frame_Assembler::receive_data() {
+    acquire_buffer();
+
+    auto offset = head_size() + frame_size;
+    if (offset + start_code_size() > buffer->size()) return buffer->data();  // no room left
+
+    std::memcpy(buffer->data() + offset, START_CODE, start_code_size());
+    return buffer->data() + offset + start_code_size();
+}
+
+std::size_t Frame_Assembler::receive_space() {
+    acquire_buffer();
+
+    auto used = head_size() + frame_size + start_code_size();
+    return used < buffer->size() ? buffer->size() - used : 0;
+}
+
+Frame_Ptr Frame_Assembler::received(std::size_t size, bool end_of_frame) {
+    if (!Frame::is_video(format)) {
+        // jpeg frames always come in whole
+        auto frame = buffer_pool->make_frame(std::move(buffer), 0, size, format, width, height,
+                                             Frame::Type::KEY, Capture_Info::now(sequence));
+        reset_frame();
+        end_frame(true);
+        return frame;
+    }
+
+    if (dropping) {
+        if (end_of_frame) reset_frame();
+        end_frame(end_of_frame);
+        return nullptr;
+    }
+
+    add_nal(buffer->data() + head_size() + frame_size + start_code_size(), size);
+    frame_size += start_code_size() + size;
+
+    // parameter sets and such sent as frames of their own stay in front of the next picture
+    if (!end_of_frame || !has_picture) return nullptr;
+
+    auto type = has_key ? Frame::Type::KEY
+                        : (has_reference ? Frame::Type::PREDICTED : Frame::Type::DISPOSABLE);
+    auto offset = head_size();
+    if (has_key && !has_parameter_sets && !parameter_sets.empty()) {
+        offset = 0;
+        std::memcpy(buffer->data(), parameter_sets.data(), parameter_sets.size());
+    }
+
+    auto frame = buffer_pool->make_frame(std::move(buffer), offset,
+                                         head_size() + frame_size - offset, format, width, height,
+                                         type, Capture_Info::now(sequence));
+    reset_frame();
+    end_frame(true);
+    return frame;
+}
+
+std::size_t Frame_Assembler::truncated(std::size_t size, std::size_t truncated_size,
+                                       bool end_of_frame) {
+    // whatever did arrive is useless on its own, so make room for a frame of this size next time
+    auto needed = head_size() + frame_size + start_code_size() + size + truncated_size;
+    buffer_pool->grow(std::min(needed * 2, camsrv::MAXIMUM_RTSP_BUFFER_SIZE));
+
+    reset_frame();
+    dropping = Frame::is_video(format) && !end_of_frame;
+    end_frame(!dropping);
+    return buffer_pool->get_buffer_size();
+}
+
+void Frame_Assembler::discard(bool end_of_frame) {
+    reset_frame();
+    dropping = Frame::is_video(format) && !end_of_frame;
+    end_frame(!dropping);
+}
+
+void Frame_Assembler::acquire_buffer() {
+    // a new frame gets a buffer of the pool's current size, in case it has grown since
+    if (buffer && frame_size == 0 && buffer->size() < buffer_pool->get_buffer_size())
+        buffer_pool->release(std::move(buffer));
+    if (!buffer) buffer = buffer_pool->acquire();
+}
+
+void Frame_Assembler::add_nal(const std::uint8_t *nal, std::size_t size) {
+    if (size == 0) return;
+
+    if (format == Frame::Format::H264) {
+        std::uint8_t type = nal[0] & 0x1f;
+        std::uint8_t reference = (nal[0] >> 5) & 0x03;  // nal_ref_idc
+        if (type >= H264_NAL_SLICE && type <= H264_NAL_IDR) {
+            has_picture = true;
+            has_key = has_key || type == H264_NAL_IDR;
+            has_reference = has_reference || reference != 0;
+        } else if (type == H264_NAL_SPS || type == H264_NAL_PPS)
+            has_parameter_sets = true;
+    } else {
+        std::uint8_t type = (nal[0] >> 1) & 0x3f;
+        if (type <= H265_NAL_RESERVED_VCL_31) {
+            // even types up to 14 are the sub-layer non-reference pictures
+            has_picture = true;
+            has_key = has_key || (type >= H265_NAL_BLA_W_LP && type <= H265_NAL_RESERVED_IRAP_23);
+            has_reference = has_reference || type > H265_NAL_RESERVED_VCL_N14 || type % 2 == 1;
+        } else if (type >= H265_NAL_VPS && type <= H265_NAL_PPS)
+            has_parameter_sets = true;
+    }
+}
+
+void Frame_Assembler::reset_frame() {
+    frame_size = 0;
+    dropping = false;
+    has_picture = false;
+    has_key = false;
+    has_reference = false;
+    has_parameter_sets = false;
+}
+
+void Frame_Assembler::end_frame(bool end_of_frame) {
+    if (end_of_frame) sequence++;
+}
+
+std::size_t Frame_Assembler::head_size() const { return parameter_sets.size(); }
+
+std::size_t Frame_Assembler::start_code_size() const {
+    return Frame::is_video(format) ? sizeof(START_CODE) : 0;
+}
@@ -0,0 +1,66 @@
+#ifndef frame_assembler__HPP
+#define frame_assembler__HPP
+
+// standard includes
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "frame.hpp"
+
+// Puts an ip camera's frames back together as they come off the network. Jpeg streams hand us a
+// whole frame at a time, h.264 and h.265 streams hand us one nal unit at a time, which get joined
+// into an access unit with start codes in front of them. Key frames that don't carry their own
+// parameter sets get the ones from the sdp put in front of them, so a client can start decoding on
+// any key frame. Everything is received straight into pooled buffers, never copied.
+class Frame_Assembler {
+public:
+    // parameter sets are annex b encoded, buffers start out at least buffer size bytes
+    Frame_Assembler(Frame::Format format, std::vector<std::uint8_t> parameter_sets,
+                    std::uint16_t width, std::uint16_t height, std::size_t buffer_size);
+
+    // where the next piece of a frame should be received to and how much room there is for it
+    std::uint8_t *receive_data();
+    std::size_t receive_space();
+
+    // size bytes were received, returns the frame once end of frame says it's complete, the frame
+    // is stamped with when its last piece arrived
+    Frame_Ptr received(std::size_t size, bool end_of_frame);
+
+    // the last piece didn't fit, the whole frame gets dropped and buffers get bigger, returns the
+    // buffer size from now on
+    std::size_t truncated(std::size_t size, std::size_t truncated_size, bool end_of_frame);
+
+    // nobody wants the frame, it's dropped without allocating anything and the buffer is reused
+    void discard(bool end_of_frame);
+
+private:
+    void acquire_buffer();  // makes sure there's a buffer of the pool's size to receive into
+    void add_nal(const std::uint8_t *nal, std::size_t size);  // works out what the frame is
+    void reset_frame();
+    void end_frame(bool end_of_frame);  // every frame gets a sequence number, even dropped ones
+
+    std::size_t head_size() const;        // room kept in front of the frame for parameter sets
+    std::size_t start_code_size() const;  // written in front of every nal unit
+
+    const Frame::Format format;
+    const std::vector<std::uint8_t> parameter_sets;
+    const std::uint16_t width;
+    const std::uint16_t height;
+
+    std::uint64_t sequence = 0;  // of the frame being put together
+
+    std::shared_ptr<Buffer_Pool> buffer_pool;  // outlives us for as long as frames need it
+    Buffer_Pool::Buffer buffer;                // buffer the frame is being received into
+
+    // frame being put together, parameter sets go in the room left in front of it if needed
+    std::size_t frame_size = 0;
+    bool dropping = false;            // rest of a truncated frame is still coming in
+    bool has_picture = false;         // anything but parameter sets and such has come in
+    bool has_key = false;             // has an idr (or irap) picture
+    bool has_reference = false;       // has a picture other pictures refer back to
+    bool has_parameter_sets = false;  // brought its own parameter sets
+};
+
+#endif
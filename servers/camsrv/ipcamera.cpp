@@ -1,22 +1,69 @@
 #include "ipcamera.hpp"
 
+// standard includes
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
 #include "defines.hpp"
+#include "frame.hpp"
+#include "frame_assembler.hpp"
 #include "server.hpp"
 
-// By default, we request that the server stream its data using RTP/UDP.
-// If, instead, you want to request that the server stream via RTP-over-TCP, change the following to
-// True:
-#define REQUEST_STREAMING_OVER_TCP False
-
 #define RTSP_CLIENT_VERBOSITY_LEVEL 1  // by default, print verbose output from each "RTSPClient"
 #define DEBUG_PRINT_EACH_RECEIVED_FRAME 0
 #define DEFAULT_SOCKET_NUMBER_TO_SERVER -1
 
-// Counts how many streams (i.e., "RTSPClient"s) are currently in use.
-static unsigned rtsp_client_count = 0;
+namespace {
+// works out what format a subsession's frames are in, only video we can hand on to clients gets
+// set up, everything else (audio included) is ignored
+bool subsession_format(MediaSubsession &subsession, Frame::Format &format) {
+    if (std::strcmp(subsession.mediumName(), "video") != 0) return false;
+
+    if (std::strcmp(subsession.codecName(), "JPEG") == 0)
+        format = Frame::Format::JPEG;
+    else if (std::strcmp(subsession.codecName(), "H264") == 0)
+        format = Frame::Format::H264;
+    else if (std::strcmp(subsession.codecName(), "H265") == 0)
+        format = Frame::Format::H265;
+    else
+        return false;
+
+    return true;
+}
 
-static char event_loop_watch_variable = 0;
-std::shared_ptr<IPCamera> ipcamera_obj;
+// parameter sets from the sdp, annex b encoded so they can go in front of key frames as they are
+std::vector<std::uint8_t> subsession_parameter_sets(MediaSubsession &subsession,
+                                                   Frame::Format format) {
+    std::vector<char const *> sprops;
+    if (format == Frame::Format::H264)
+        sprops = {subsession.fmtp_spropparametersets()};
+    else if (format == Frame::Format::H265)
+        sprops = {subsession.fmtp_spropvps(), subsession.fmtp_spropsps(),
+                  subsession.fmtp_sproppps()};
+
+    const std::uint8_t start_code[] = {0, 0, 0, 1};
+    std::vector<std::uint8_t> parameter_sets;
+    for (auto sprop : sprops) {
+        if (sprop == nullptr || *sprop == '\0') continue;
+
+        unsigned count = 0;
+        SPropRecord *records = parseSPropParameterSets(sprop, count);
+        for (unsigned i = 0; i < count; i++) {
+            parameter_sets.insert(parameter_sets.end(), std::begin(start_code),
+                                  std::end(start_code));
+            parameter_sets.insert(parameter_sets.end(), records[i].sPropBytes,
+                                  records[i].sPropBytes + records[i].sPropLength);
+        }
+        delete[] records;
+    }
+
+    return parameter_sets;
+}
+}  // namespace
 
 // Define a class to hold per-stream state that we maintain throughout each stream's lifetime:
 class StreamClientState {
@@ -40,17 +87,19 @@ public:
 class ourRTSPClient : public RTSPClient {
 public:
     static ourRTSPClient *create_new(UsageEnvironment &environment, char const *rtsp_url,
-                                     int verbosity_level = 0,
+                                     IPCamera &camera, int verbosity_level = 0,
                                      char const *application_name = nullptr,
                                      portNumBits tunnel_over_http_port_num = 0);
 
 protected:
-    ourRTSPClient(UsageEnvironment &environment, char const *rtsp_url, int verbosity_level,
-                  char const *application_name, portNumBits tunnel_over_http_port_num);
+    ourRTSPClient(UsageEnvironment &environment, char const *rtsp_url, IPCamera &camera,
+                  int verbosity_level, char const *application_name,
+                  portNumBits tunnel_over_http_port_num);
     // called only by createNew();
 
 public:
     StreamClientState stream_client_state;
+    IPCamera &camera;  // camera this stream belongs to
 };
 
 // Define a data sink (a subclass of "MediaSink") to receive the data for each subsession (i.e.,
@@ -63,11 +112,14 @@ public:
     static DummySink *create_new(
         UsageEnvironment &environment,
         MediaSubsession &subsession,       // identifies the kind of data that's being received
+        Frame::Format format,              // format the subsession's frames are in
+        IPCamera &camera,                  // camera every frame received gets handed to
         char const *stream_id = nullptr);  // identifies the stream itself (optional)
 
 private:
     // called only by "createNew()"
-    DummySink(UsageEnvironment &environment, MediaSubsession &subsession, char const *stream_id);
+    DummySink(UsageEnvironment &environment, MediaSubsession &subsession, Frame::Format format,
+              IPCamera &camera, char const *stream_id);
 
     virtual ~DummySink();
 
@@ -81,8 +133,9 @@ private:
     virtual Boolean continuePlaying();  // redefined virtual functions
 
 private:
-    u_int8_t *receive_buffer;
+    Frame_Assembler assembler;  // frames get received straight into its buffers
     MediaSubsession &subsession;
+    IPCamera &camera;
     char *stream_id;
 };
 
@@ -107,46 +160,50 @@ StreamClientState::~StreamClientState() {
 // Implementation of "ourRTSPClient":
 
 ourRTSPClient *ourRTSPClient::create_new(UsageEnvironment &environment, char const *url,
-                                         int verbosity_level, char const *application_name,
+                                         IPCamera &camera, int verbosity_level,
+                                         char const *application_name,
                                          portNumBits tunnel_over_http_port_num) {
-    return new ourRTSPClient(environment, url, verbosity_level, application_name,
+    return new ourRTSPClient(environment, url, camera, verbosity_level, application_name,
                              tunnel_over_http_port_num);
 }
 
-ourRTSPClient::ourRTSPClient(UsageEnvironment &environment, char const *url, int verbosity_level,
-                             char const *application_name, portNumBits tunnel_over_http_port_num)
+ourRTSPClient::ourRTSPClient(UsageEnvironment &environment, char const *url, IPCamera &c,
+                             int verbosity_level, char const *application_name,
+                             portNumBits tunnel_over_http_port_num)
     : RTSPClient(environment, url, verbosity_level, application_name, tunnel_over_http_port_num,
-                 DEFAULT_SOCKET_NUMBER_TO_SERVER) {}
+                 DEFAULT_SOCKET_NUMBER_TO_SERVER),
+      camera(c) {}
 
 // Implementation of "DummySink":
 
-// Even though we're not going to be doing anything with the incoming data, we still need to receive
-// it. Define the size of the buffer that we'll use:
-#define DUMMY_SINK_RECEIVE_BUFFER_SIZE 100000
-
 DummySink *DummySink::create_new(UsageEnvironment &environment, MediaSubsession &ss,
-                                 char const *id) {
-    return new DummySink(environment, ss, id);
+                                 Frame::Format format, IPCamera &c, char const *id) {
+    return new DummySink(environment, ss, format, c, id);
 }
 
-DummySink::DummySink(UsageEnvironment &environment, MediaSubsession &ss, char const *id)
-    : MediaSink(environment), subsession(ss) {
+// a compressed frame is very unlikely to need more than a byte per pixel, so that's what buffers
+// start out at
+DummySink::DummySink(UsageEnvironment &environment, MediaSubsession &ss, Frame::Format format,
+                     IPCamera &c, char const *id)
+    : MediaSink(environment),
+      assembler(format, subsession_parameter_sets(ss, format), ss.videoWidth(), ss.videoHeight(),
+                static_cast<std::size_t>(ss.videoWidth()) * ss.videoHeight()),
+      subsession(ss),
+      camera(c) {
     stream_id = strDup(id);
-    receive_buffer = new u_int8_t[DUMMY_SINK_RECEIVE_BUFFER_SIZE];
 }
 
-DummySink::~DummySink() {
-    delete[] receive_buffer;
-    delete[] stream_id;
-}
+DummySink::~DummySink() { delete[] stream_id; }
 
 Boolean DummySink::continuePlaying() {
     if (fSource == nullptr) return False;  // sanity check (should not happen)
 
     // Request the next frame of data from our input source.  "afterGettingFrame()" will get called
-    // later, when it arrives:
-    fSource->getNextFrame(receive_buffer, DUMMY_SINK_RECEIVE_BUFFER_SIZE, after_getting_frame, this,
-                          onSourceClosure, this);
+    // later, when it arrives. Video arrives a nal unit at a time, those get joined into a frame.
+    auto to = assembler.receive_data();
+    auto space = static_cast<unsigned>(
+        std::min(assembler.receive_space(), static_cast<std::size_t>(UINT_MAX)));
+    fSource->getNextFrame(to, space, after_getting_frame, this, onSourceClosure, this);
     return True;
 }
 
@@ -154,7 +211,22 @@ void DummySink::after_getting_frame(void *data, unsigned size, unsigned truncate
                                     struct timeval presentation_time,
                                     unsigned duration_microseconds) {
     DummySink *ds = reinterpret_cast<DummySink *>(data);
-    ipcamera_obj->get_frame(ds->receive_buffer, size);
+
+    // the rtp marker bit is set on the last packet of an access unit
+    auto rtp_source = ds->subsession.rtpSource();
+    bool end_of_frame = rtp_source == nullptr || rtp_source->curPacketMarkerBit();
+
+    if (truncated_size > 0) {
+        auto buffer_size = ds->assembler.truncated(size, truncated_size, end_of_frame);
+        ds->camera.frame_truncated(truncated_size, buffer_size);
+    } else if (!ds->camera.is_streaming()) {
+        ds->assembler.discard(end_of_frame);
+        ds->camera.frame_discarded(size);
+    } else if (auto frame = ds->assembler.received(size, end_of_frame)) {
+        // presentation times are on the camera's clock once rtcp has synchronized them and jump
+        // when it does, frames are stamped with when they got to us instead
+        ds->camera.get_frame(std::move(frame));
+    }
     ds->after_getting_frame(size, truncated_size, presentation_time);
 }
 
@@ -201,29 +273,92 @@ UsageEnvironment &operator<<(UsageEnvironment &environment, const MediaSubsessio
 }
 
 IPCamera::IPCamera(std::shared_ptr<Server> svr, boost::asio::io_service &controller_service,
-                   boost::asio::io_service &io_service, std::string url)
-    : Camera(svr, controller_service, io_service, url) {
-    ipcamera_obj = std::shared_ptr<IPCamera>(this);
-    scheduler = BasicTaskScheduler::createNew();
-    environment = BasicUsageEnvironment::createNew(*scheduler);
-    open_url(*environment, camsrv::CAMSRV_APPLICATION_NAME.c_str(),
-             Camera::get_device_name().c_str());  // TODO make camsrv a const
+                   boost::asio::io_service &io_service, std::string url, std::uint32_t stream_id,
+                   camsrv::rtsp_options_type ro, Rtsp_Loop &loop)
+    : Camera(svr, controller_service, io_service, url, stream_id),
+      rtsp_loop(loop),
+      rtsp_options(ro),
+      random(std::random_device{}()),
+      stream_stats(svr->get_stream_stats(stream_id)) {
+    // live555 may only be touched from its own loop
+    rtsp_loop.post([this]() {
+        open_url(rtsp_loop.get_environment(), camsrv::CAMSRV_APPLICATION_NAME.c_str(),
+                 Camera::get_device_name().c_str());  // TODO make camsrv a const
+    });
+}
+
+IPCamera::~IPCamera() {
+    // nothing else touches live555 once its loop has stopped, so it's safe to tear down from here
+    closing = true;
+    auto &scheduler = rtsp_loop.get_environment().taskScheduler();
+    scheduler.unscheduleDelayedTask(reconnect_task);
+    scheduler.unscheduleDelayedTask(watchdog_task);
+    scheduler.unscheduleDelayedTask(idle_teardown_task);
+    if (rtsp_client) shutdown_stream(rtsp_client);
+}
+
+void IPCamera::set_stream(bool on) {
+    Camera::set_stream(on);  // the sink stops handing frames on straight away
+
+    // live555 may only be touched from its own loop
+    rtsp_loop.post([this]() { update_session(); });
+}
 
-    environment->taskScheduler().doEventLoop(&event_loop_watch_variable);
+void IPCamera::update_session() {
+    if (closing || session_busy) return;  // the reply to the request in flight checks again
+
+    bool wanted = Camera::is_streaming();
+    if (!rtsp_client) {
+        // torn down while idle, or waiting to reconnect
+        if (wanted && !reconnect_task) {
+            SLOG_INFO("ipc", "setting up camera again",
+                      slog::field("camera", Camera::get_device_name()));
+            open_url(rtsp_loop.get_environment(), camsrv::CAMSRV_APPLICATION_NAME.c_str(),
+                     Camera::get_device_name().c_str());
+        }
+        return;
+    } else if (!session_playing)
+        return;  // still being set up, looked at again once it plays
+
+    auto &scs = reinterpret_cast<ourRTSPClient *>(rtsp_client)->stream_client_state;
+    if (wanted && session_paused) {
+        // a negative start resumes from wherever the session was paused
+        session_busy = true;
+        rtsp_client->sendPlayCommand(*scs.session, continue_after_resume, -1.0f);
+    } else if (!wanted && !session_paused) {
+        session_busy = true;
+        rtsp_client->sendPauseCommand(*scs.session, continue_after_pause);
+    }
+}
+
+void IPCamera::idle_teardown_handler(void *data) {
+    auto camera = reinterpret_cast<IPCamera *>(data);
+    camera->idle_teardown_task = nullptr;
+    if (!camera->rtsp_client) return;  // sanity check
+
+    SLOG_INFO("ipc", "camera has been idle, tearing it down",
+              slog::field("camera", camera->get_device_name()),
+              slog::field("idle_seconds", camsrv::RTSP_IDLE_TEARDOWN_SECONDS));
+    camera->stream_stats.idle_teardowns++;
+    shutdown_stream(camera->rtsp_client);  // nobody is streaming, so it won't be reconnected
 }
 
 void IPCamera::open_url(UsageEnvironment &env, char const *name, char const *url) {
     // Begin by creating a "RTSPClient" object.  Note that there is a separate "RTSPClient" object
     // for each stream that we wish to receive (even if more than stream uses the same "rtsp://"
     // URL).
-    RTSPClient *client = ourRTSPClient::createNew(env, url, RTSP_CLIENT_VERBOSITY_LEVEL, name);
+    portNumBits http_port =
+        rtsp_options.transport == camsrv::rtsp_transport_type::HTTP ? rtsp_options.http_port : 0;
+    RTSPClient *client =
+        ourRTSPClient::create_new(env, url, *this, RTSP_CLIENT_VERBOSITY_LEVEL, name, http_port);
     if (client == nullptr) {
         env << "Failed to create a RTSP client for URL \"" << url << "\": " << env.getResultMsg()
             << "\n";
+        schedule_reconnect();
         return;
     }
 
-    ++rtsp_client_count;
+    rtsp_client = client;
 
     // Next, send a RTSP "DESCRIBE" command, to get a SDP description for the stream.
     // Note that this command - like all RTSP commands - is sent asynchronously; we do not block,
@@ -232,15 +367,118 @@ void IPCamera::open_url(UsageEnvironment &env, char const *name, char const *url
     client->sendDescribeCommand(continue_after_describe);
 }
 
-void IPCamera::get_frame(void *data, unsigned size) {
-    std::vector<std::uint8_t> sf;
-    sf.resize(size);
-    std::memcpy(sf.data(), data, size);
+void IPCamera::get_frame(Frame_Ptr frame) {
+    // frames are coming through, so the next time the stream ends we start backing off over again
+    frames_received++;
+    reconnect_attempts = 0;
+
+    // the sink already discards frames nobody wants, this only catches the stream being turned off
+    // while a frame was being put together
+    if (!Camera::is_streaming()) return;
+
+    Camera::controller_service.post(
+        std::bind(&Server::send_frame, server, Camera::get_stream_id(), std::move(frame)));
+}
+
+void IPCamera::frame_truncated(unsigned truncated_size, std::size_t buffer_size) {
+    auto frames_truncated = ++stream_stats.frames_truncated;
+    stream_stats.bytes_truncated += truncated_size;
+    SLOG_WARNING("ipc", "dropped truncated frame", slog::field("camera", Camera::get_device_name()),
+                 slog::field("missing_bytes", truncated_size),
+                 slog::field("buffer_size", buffer_size),
+                 slog::field("frames_truncated", frames_truncated));
+}
 
-    // no real way to turn on and off streaming on the ip camera, so we just don't send data
-    // if the stream is "off"
-    if (Camera::is_streaming())
-        Camera::controller_service.post(std::bind(&Server::send_frame, ipcamera_obj->server, sf));
+void IPCamera::frame_discarded(unsigned size) {
+    frames_received++;
+    stream_stats.frames_discarded++;
+    stream_stats.bytes_discarded += size;
+}
+
+void IPCamera::schedule_reconnect() {
+    // backing off exponentially, with jitter so cameras that went down together don't all come
+    // back at the same moment
+    auto delay = std::min<std::uint64_t>(
+        static_cast<std::uint64_t>(camsrv::MINIMUM_RTSP_RECONNECT_DELAY_MS)
+            << std::min<std::uint32_t>(reconnect_attempts, 16),
+        camsrv::MAXIMUM_RTSP_RECONNECT_DELAY_MS);
+    delay = std::uniform_int_distribution<std::uint64_t>(delay / 2, delay)(random);
+    reconnect_attempts++;
+
+    SLOG_WARNING("ipc", "reconnecting to camera", slog::field("camera", Camera::get_device_name()),
+                 slog::field("delay_ms", delay), slog::field("attempt", reconnect_attempts));
+    reconnect_task = rtsp_loop.get_environment().taskScheduler().scheduleDelayedTask(
+        static_cast<std::int64_t>(delay * 1000), reconnect_handler, this);
+}
+
+void IPCamera::reconnect_handler(void *data) {
+    auto camera = reinterpret_cast<IPCamera *>(data);
+    camera->reconnect_task = nullptr;
+    if (!camera->is_streaming()) return;  // set up again once someone streams
+
+    camera->stream_stats.rtp_reconnects++;
+
+    camera->open_url(camera->rtsp_loop.get_environment(), camsrv::CAMSRV_APPLICATION_NAME.c_str(),
+                     camera->get_device_name().c_str());
+}
+
+void IPCamera::schedule_watchdog() {
+    frames_at_last_check = frames_received;
+    watchdog_task = rtsp_loop.get_environment().taskScheduler().scheduleDelayedTask(
+        static_cast<std::int64_t>(camsrv::RTSP_STREAM_TIMEOUT_SECONDS) * 1000000, watchdog_handler,
+        this);
+}
+
+void IPCamera::watchdog_handler(void *data) {
+    auto camera = reinterpret_cast<IPCamera *>(data);
+    camera->watchdog_task = nullptr;
+    if (!camera->rtsp_client) return;  // sanity check
+
+    camera->update_rtp_statistics();
+    if (camera->frames_received == camera->frames_at_last_check) {
+        SLOG_WARNING("ipc", "no frames from camera",
+                     slog::field("camera", camera->get_device_name()),
+                     slog::field("timeout_seconds", camsrv::RTSP_STREAM_TIMEOUT_SECONDS));
+        shutdown_stream(camera->rtsp_client);
+        return;
+    }
+
+    camera->schedule_watchdog();
+}
+
+void IPCamera::update_rtp_statistics() {
+    auto &scs = reinterpret_cast<ourRTSPClient *>(rtsp_client)->stream_client_state;
+    if (scs.session == nullptr) return;
+
+    std::uint64_t packets_received = 0;
+    std::uint64_t packets_lost = 0;
+    double jitter_ms = 0;
+    MediaSubsessionIterator it(*scs.session);
+    MediaSubsession *ms;
+    while ((ms = it.next()) != nullptr) {
+        auto source = ms->rtpSource();
+        if (source == nullptr) continue;
+
+        RTPReceptionStatsDB::Iterator stats_it(source->receptionStatsDB());
+        RTPReceptionStats *stats;
+        while ((stats = stats_it.next(True)) != nullptr) {
+            packets_received += stats->totNumPacketsReceived();
+            if (stats->totNumPacketsExpected() > stats->totNumPacketsReceived())
+                packets_lost += stats->totNumPacketsExpected() - stats->totNumPacketsReceived();
+            if (source->timestampFrequency() > 0)
+                jitter_ms = std::max(jitter_ms,
+                                     stats->jitter() * 1000.0 / source->timestampFrequency());
+        }
+    }
+
+    stream_stats.rtp_packets_received = packets_received;
+    stream_stats.rtp_packets_lost = packets_lost;
+    stream_stats.rtp_jitter_us = static_cast<std::uint64_t>(jitter_ms * 1000);
+
+    SLOG_INFO("ipc", "rtp statistics", slog::field("camera", Camera::get_device_name()),
+              slog::field("packets_received", packets_received),
+              slog::field("packets_lost", packets_lost), slog::field("jitter_ms", jitter_ms),
+              slog::field("reconnects", stream_stats.rtp_reconnects.load()));
 }
 
 void IPCamera::continue_after_describe(RTSPClient *client, int result, char *result_string) {
@@ -288,7 +526,12 @@ void IPCamera::setup_next_subsession(RTSPClient *client) {
 
     scs.subsession = scs.iterator->next();
     if (scs.subsession != nullptr) {
-        if (!scs.subsession->initiate()) {
+        Frame::Format format;
+        if (!subsession_format(*scs.subsession, format)) {
+            env << *client << "Ignoring the \"" << *scs.subsession
+                << "\" subsession, only jpeg, h.264 and h.265 video is supported\n";
+            setup_next_subsession(client);
+        } else if (!scs.subsession->initiate()) {
             env << *client << "Failed to initiate the \"" << *scs.subsession
                 << "\" subsession: " << env.getResultMsg() << "\n";
             setup_next_subsession(client);  // give up on this subsession; go to the next one
@@ -302,9 +545,12 @@ void IPCamera::setup_next_subsession(RTSPClient *client) {
             }
             env << ")\n";
 
-            // Continue setting up this subsession, by sending a RTSP "SETUP" command
-            client->sendSetupCommand(*scs.subsession, continue_after_setup, False,
-                                     REQUEST_STREAMING_OVER_TCP);
+            // Continue setting up this subsession, by sending a RTSP "SETUP" command. Tunneling
+            // over http always streams over the tunnel's tcp connection.
+            auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+            Boolean over_tcp =
+                camera.rtsp_options.transport != camsrv::rtsp_transport_type::UDP ? True : False;
+            client->sendSetupCommand(*scs.subsession, continue_after_setup, False, over_tcp);
         }
         return;
     }
@@ -322,7 +568,7 @@ void IPCamera::setup_next_subsession(RTSPClient *client) {
     }
 }
 
-void IPCamera::shutdown_stream(RTSPClient *client, int exit_code) {
+void IPCamera::shutdown_stream(RTSPClient *client) {
     UsageEnvironment &env = client->envir();  // alias
     StreamClientState &scs =
         (reinterpret_cast<ourRTSPClient *>(client))->stream_client_state;  // alias
@@ -352,14 +598,22 @@ void IPCamera::shutdown_stream(RTSPClient *client, int exit_code) {
     }
 
     env << *client << "Closing the stream.\n";
+    auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+    env.taskScheduler().unscheduleDelayedTask(camera.watchdog_task);
+    env.taskScheduler().unscheduleDelayedTask(camera.idle_teardown_task);
+    camera.rtsp_client = nullptr;
+    camera.session_playing = false;
+    camera.session_paused = false;
+    camera.session_busy = false;  // nothing is going to answer anymore
     Medium::close(client);
     // Note that this will also cause this stream's "StreamClientState" structure to get reclaimed.
 
-    // The final stream has ended, so exit the application now.
-    // (Of course, if you're embedding this code into your own application, you might want to
-    // comment this out, and replace it with "eventLoopWatchVariable = 1;", so that we leave the
-    // LIVE555 event loop, and continue running "main()".)
-    if (--rtsp_client_count == 0) exit(exit_code);
+    // a camera that rebooted or dropped off the network for a bit is still worth waiting on, but
+    // only if someone wants it, otherwise it's set up again once someone does
+    if (!camera.closing && camera.is_streaming()) {
+        SLOG_WARNING("ipc", "stream has ended", slog::field("camera", camera.get_device_name()));
+        camera.schedule_reconnect();
+    }
 }
 
 void IPCamera::continue_after_setup(RTSPClient *client, int result, char *result_string) {
@@ -387,7 +641,11 @@ void IPCamera::continue_after_setup(RTSPClient *client, int result, char *result
         // "startPlaying()" on it. (This will prepare the data sink to receive data; the actual flow
         // of data from the client won't start happening until later, after we've sent a RTSP "PLAY"
         // command.)
-        scs.subsession->sink = DummySink::create_new(env, *scs.subsession, client->url());
+        auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+        Frame::Format format;
+        subsession_format(*scs.subsession, format);  // only supported subsessions get set up
+        scs.subsession->sink =
+            DummySink::create_new(env, *scs.subsession, format, camera, client->url());
         if (scs.subsession->sink == nullptr) {
             env << *client << "Failed to create a data sink for the \"" << *scs.subsession
                 << "\" subsession: " << env.getResultMsg() << "\n";
@@ -418,7 +676,7 @@ void IPCamera::continue_after_play(RTSPClient *client, int result, char *result_
         StreamClientState &scs =
             (reinterpret_cast<ourRTSPClient *>(client))->stream_client_state;  // alias
 
-        if (client != 0) {
+        if (result != 0) {
             env << *client << "Failed to start playing session: " << result_string << "\n";
             break;
         }
@@ -443,6 +701,11 @@ void IPCamera::continue_after_play(RTSPClient *client, int result, char *result_
         if (scs.duration > 0) env << " (for up to " << scs.duration << " seconds)";
         env << "...\n";
 
+        auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+        camera.session_playing = true;
+        camera.schedule_watchdog();
+        camera.update_session();  // pauses straight away if nobody is streaming
+
         res = True;
     } while (0);
     delete[] result_string;
@@ -451,6 +714,59 @@ void IPCamera::continue_after_play(RTSPClient *client, int result, char *result_
     if (!res) shutdown_stream(client);
 }
 
+void IPCamera::continue_after_pause(RTSPClient *client, int result, char *result_string) {
+    UsageEnvironment &env = client->envir();  // alias
+    auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+    camera.session_busy = false;
+
+    if (result != 0) {
+        // not every camera can pause, tearing down gets us the same thing at the cost of a slower
+        // start next time
+        env << *client << "Failed to pause session: " << result_string << "\n";
+        delete[] result_string;
+        camera.stream_stats.idle_teardowns++;
+        shutdown_stream(client);
+        return;
+    }
+    delete[] result_string;
+
+    camera.stream_stats.pauses++;
+    camera.session_paused = true;
+    SLOG_INFO("ipc", "paused camera", slog::field("camera", camera.get_device_name()),
+              slog::field("frames_discarded", camera.stream_stats.frames_discarded.load()),
+              slog::field("bytes_discarded", camera.stream_stats.bytes_discarded.load()));
+
+    // nothing comes in while paused, so there's no point watching for it
+    auto &scheduler = env.taskScheduler();
+    scheduler.unscheduleDelayedTask(camera.watchdog_task);
+    camera.idle_teardown_task = scheduler.scheduleDelayedTask(
+        static_cast<std::int64_t>(camsrv::RTSP_IDLE_TEARDOWN_SECONDS) * 1000000,
+        idle_teardown_handler, &camera);
+
+    camera.update_session();  // someone may have started streaming in the meantime
+}
+
+void IPCamera::continue_after_resume(RTSPClient *client, int result, char *result_string) {
+    UsageEnvironment &env = client->envir();  // alias
+    auto &camera = reinterpret_cast<ourRTSPClient *>(client)->camera;
+    camera.session_busy = false;
+
+    if (result != 0) {
+        env << *client << "Failed to resume session: " << result_string << "\n";
+        delete[] result_string;
+        shutdown_stream(client);  // set up from scratch instead
+        return;
+    }
+    delete[] result_string;
+
+    SLOG_INFO("ipc", "resumed camera", slog::field("camera", camera.get_device_name()));
+    camera.session_paused = false;
+    env.taskScheduler().unscheduleDelayedTask(camera.idle_teardown_task);
+    camera.schedule_watchdog();
+
+    camera.update_session();  // someone may have stopped streaming in the meantime
+}
+
 void IPCamera::subsession_after_playing(void *data) {
     MediaSubsession *ms = reinterpret_cast<MediaSubsession *>(data);
     RTSPClient *cl = reinterpret_cast<RTSPClient *>(ms->miscPtr);
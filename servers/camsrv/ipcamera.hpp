@@ -2,31 +2,43 @@
 #define IPCAMERA__HPP
 
 // standard includes
+#include <atomic>
 #include <iostream>
-#include <thread>
+#include <random>
 
 // live555 includes
 #include <BasicUsageEnvironment.hh>
 #include <liveMedia.hh>
 
 #include "camera.hpp"
+#include "defines.hpp"
+#include "frame.hpp"
+#include "rtsp_loop.hpp"
+#include "stats.hpp"
 
 class Server;  // forward declaration
 
 class IPCamera : public Camera {
 public:
     IPCamera(std::shared_ptr<Server> server, boost::asio::io_service &controller_service,
-             boost::asio::io_service &io_service, std::string rtsp_url);
+             boost::asio::io_service &io_service, std::string rtsp_url, std::uint32_t stream_id,
+             camsrv::rtsp_options_type rtsp_options, Rtsp_Loop &rtsp_loop);
+    ~IPCamera();  // rtsp loop must have been stopped first
 
-    void get_frame(
-        void *data,
-        unsigned size);  // TODO, this probably shouldn't be public, only used by dummysink+
+    void set_stream(bool on) override;  // pauses or resumes the rtsp session
+
+    // TODO, these probably shouldn't be public, only used by dummysink+
+    void get_frame(Frame_Ptr frame);
+    void frame_truncated(unsigned truncated_size, std::size_t buffer_size);
+    void frame_discarded(unsigned size);  // arrived while nobody was streaming
 
 private:
     // RTSP 'response handlers'
     static void continue_after_describe(RTSPClient *client, int result, char *result_string);
     static void continue_after_setup(RTSPClient *client, int result, char *result_string);
     static void continue_after_play(RTSPClient *client, int result, char *result_string);
+    static void continue_after_pause(RTSPClient *client, int result, char *result_string);
+    static void continue_after_resume(RTSPClient *client, int result, char *result_string);
 
     // Other event handler functions
 
@@ -42,12 +54,45 @@ private:
     void open_url(UsageEnvironment &environment, char const *program_name, char const *rtsp_url);
     // Used to iterate through each stream's 'subsessions', setting up each one
     static void setup_next_subsession(RTSPClient *client);
-    // Used to shut down and close a stream (including its "RTSPClient" object)
-    static void shutdown_stream(RTSPClient *client, int exit_code = 1);
+    // Used to shut down and close a stream (including its "RTSPClient" object), the stream gets
+    // reconnected unless we're closing
+    static void shutdown_stream(RTSPClient *client);
+
+    // reconnecting, the delay doubles with every attempt until a frame comes through again
+    void schedule_reconnect();
+    static void reconnect_handler(void *data);
+
+    // pauses or resumes the session until it matches whether anyone is streaming, a session paused
+    // for long enough is torn down and only set up again once someone streams
+    void update_session();
+    static void idle_teardown_handler(void *data);
+
+    // checks the stream is still alive every so often, and updates its statistics
+    void schedule_watchdog();
+    static void watchdog_handler(void *data);
+    void update_rtp_statistics();
+
+    // live555 api, shared with every other ip camera
+    Rtsp_Loop &rtsp_loop;
+    RTSPClient *rtsp_client = nullptr;
+    bool closing = false;  // stream is being shut down on purpose rather than having ended
+    const camsrv::rtsp_options_type rtsp_options;
+
+    // only ever touched on the rtsp loop
+    TaskToken reconnect_task = nullptr;
+    TaskToken watchdog_task = nullptr;
+    TaskToken idle_teardown_task = nullptr;
+    bool session_playing = false;  // play has succeeded at least once on the current client
+    bool session_paused = false;
+    bool session_busy = false;  // pause or resume is waiting on the camera
+    std::uint32_t reconnect_attempts = 0;
+    std::uint64_t frames_received = 0;  // frames that arrived, whether anyone wanted them or not
+    std::uint64_t frames_at_last_check = 0;  // frames received when the watchdog last looked
+    std::minstd_rand random;                 // reconnect jitter
 
-    // live555 api
-    UsageEnvironment *environment = nullptr;
-    TaskScheduler *scheduler = nullptr;
+    // rtp, frames that didn't fit the sink's buffer and what being idle costs (frames only keep
+    // coming until the camera has paused), the stats command reports it
+    Stream_Stats &stream_stats;
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
+#include <cstdio>
 #include <iostream>
 
 #include "controller.hpp"
@@ -14,14 +15,22 @@ const int OPTION_HANDLES_COMBO = 2;
 
 // Creating an options table for user experience
 const int OPTIONS_NUMBER_PARAMS = 3;
-const int OPTIONS_NUMBER_ELEMENTS = 5;
+const int OPTIONS_NUMBER_ELEMENTS = 13;
 const std::array<const std::array<std::string, OPTIONS_NUMBER_PARAMS>, OPTIONS_NUMBER_ELEMENTS>
     OPTIONS_HANDLE = {{
         {"help", "h", "Displays this help."},
         {"version", "v", "Displays version information"},
-        {"device_name", "d", "Device name/path for a camera (e.g. /dev/video0)"},
+        {"device_name", "d", "Device name/path for a camera (e.g. /dev/video0), can be repeated"},
         {"port", "p", "TCP/IP port for server to listen on."},
-        {"url", "u", "URL for RTSP to IP Camera."},
+        {"url", "u", "URL for RTSP to IP Camera, can be repeated."},
+        {"buffers", "b", "Number of capture buffers to request from a webcamera device."},
+        {"encoder_threads", "e", "Number of threads re-encoding frames for clients."},
+        {"shm_name", "s", "Shared memory ring local clients read frames from (e.g. /camsrv)"},
+        {"pixel_format", "f", "Webcamera pixel format: mjpeg, yuyv or nv12 (default: first found)"},
+        {"resolution", "r", "Webcamera resolution, the closest the device supports is used."},
+        {"fps", "t", "Webcamera framerate, the closest the device supports is used."},
+        {"rtsp_transport", "n", "IP camera transport: udp, tcp or http[:port] (default: udp)"},
+        {"stats_interval", "i", "Seconds between printed stats lines, 0 only reports on request."},
     }};
 
 // enumeration of options
@@ -31,6 +40,14 @@ enum OPTIONS {
     DEVICE_NAME = 2,
     PORT = 3,
     URL = 4,
+    BUFFERS = 5,
+    ENCODER_THREADS = 6,
+    SHM_NAME = 7,
+    PIXEL_FORMAT = 8,
+    RESOLUTION = 9,
+    FPS = 10,
+    RTSP_TRANSPORT = 11,
+    STATS_INTERVAL = 12,
 };
 
 // enumeration of option parameters
@@ -77,9 +94,8 @@ std::string get_options_long_handle(OPTIONS index) {
 
 int main(int argc, char **argv) {
     namespace prog_opts = boost::program_options;  // consolidating our namespace naming convention
-    std::string device_name;                       // device name for our webcamera
     std::uint16_t port_number;                     // port number to be used for our server
-    std::string url;                               // url to be used for our ip camera
+    camsrv::controller_options_type co;            // camera and encoding options
 
     // Getting our options values. NOTE: created a separate object only for readability
     auto hlp_hdl = get_option_handles(OPTIONS::HELP);
@@ -87,14 +103,46 @@ int main(int argc, char **argv) {
     auto opt_hdl = get_option_handles(OPTIONS::VERSION);
     auto opt_desc = get_options_description(OPTIONS::VERSION);
     auto dev_hdl = get_option_handles(OPTIONS::DEVICE_NAME);
-    auto dev_opt = prog_opts::value<decltype(device_name)>(&device_name);
+    auto dev_opt = prog_opts::value<decltype(co.device_names)>(&co.device_names);
     auto dev_desc = get_options_description(OPTIONS::DEVICE_NAME);
     auto port_hdl = get_option_handles(OPTIONS::PORT);
     auto port_opt = prog_opts::value<decltype(port_number)>(&port_number);
     auto port_desc = get_options_description(OPTIONS::PORT);
     auto url_hdl = get_option_handles(OPTIONS::URL);
-    auto url_opt = prog_opts::value<decltype(url)>(&url);
+    auto url_opt = prog_opts::value<decltype(co.urls)>(&co.urls);
     auto url_desc = get_options_description(OPTIONS::URL);
+    auto buf_hdl = get_option_handles(OPTIONS::BUFFERS);
+    auto buf_opt = prog_opts::value<decltype(co.capture.buffer_count)>(&co.capture.buffer_count)
+                       ->default_value(co.capture.buffer_count);
+    auto buf_desc = get_options_description(OPTIONS::BUFFERS);
+    auto enc_hdl = get_option_handles(OPTIONS::ENCODER_THREADS);
+    auto enc_opt = prog_opts::value<decltype(co.encoder_threads)>(&co.encoder_threads)
+                       ->default_value(co.encoder_threads);
+    auto enc_desc = get_options_description(OPTIONS::ENCODER_THREADS);
+    auto shm_hdl = get_option_handles(OPTIONS::SHM_NAME);
+    auto shm_opt = prog_opts::value<decltype(co.shm_name)>(&co.shm_name);
+    auto shm_desc = get_options_description(OPTIONS::SHM_NAME);
+    auto pix_hdl = get_option_handles(OPTIONS::PIXEL_FORMAT);
+    auto pix_opt = prog_opts::value<decltype(co.capture.pixel_format)>(&co.capture.pixel_format);
+    auto pix_desc = get_options_description(OPTIONS::PIXEL_FORMAT);
+    std::string resolution = std::to_string(co.capture.width) + "x" +
+                             std::to_string(co.capture.height);  // parsed once options are read
+    auto res_hdl = get_option_handles(OPTIONS::RESOLUTION);
+    auto res_opt = prog_opts::value<decltype(resolution)>(&resolution)->default_value(resolution);
+    auto res_desc = get_options_description(OPTIONS::RESOLUTION);
+    auto fps_hdl = get_option_handles(OPTIONS::FPS);
+    auto fps_opt =
+        prog_opts::value<decltype(co.capture.fps)>(&co.capture.fps)->default_value(co.capture.fps);
+    auto fps_desc = get_options_description(OPTIONS::FPS);
+    std::string rtsp_transport = "udp";  // parsed once options are read
+    auto rtsp_hdl = get_option_handles(OPTIONS::RTSP_TRANSPORT);
+    auto rtsp_opt =
+        prog_opts::value<decltype(rtsp_transport)>(&rtsp_transport)->default_value(rtsp_transport);
+    auto rtsp_desc = get_options_description(OPTIONS::RTSP_TRANSPORT);
+    auto stat_hdl = get_option_handles(OPTIONS::STATS_INTERVAL);
+    auto stat_opt = prog_opts::value<decltype(co.stats_interval)>(&co.stats_interval)
+                        ->default_value(co.stats_interval);
+    auto stat_desc = get_options_description(OPTIONS::STATS_INTERVAL);
 
     // creating our options table
     prog_opts::options_description desc(OPTIONS_DESCRIPTION);
@@ -103,7 +151,12 @@ int main(int argc, char **argv) {
                                            dev_desc.c_str())(port_hdl.c_str(), port_opt,
                                                              port_desc.c_str())(url_hdl.c_str(),
                                                                                 url_opt,
-                                                                                url_desc.c_str());
+                                                                                url_desc.c_str())(
+        buf_hdl.c_str(), buf_opt, buf_desc.c_str())(enc_hdl.c_str(), enc_opt, enc_desc.c_str())(
+        shm_hdl.c_str(), shm_opt, shm_desc.c_str())(pix_hdl.c_str(), pix_opt, pix_desc.c_str())(
+        res_hdl.c_str(), res_opt, res_desc.c_str())(fps_hdl.c_str(), fps_opt, fps_desc.c_str())(
+        rtsp_hdl.c_str(), rtsp_opt, rtsp_desc.c_str())(stat_hdl.c_str(), stat_opt,
+                                                         stat_desc.c_str());
 
     // grabbing options from command line
     prog_opts::variables_map vars_map;
@@ -124,14 +177,13 @@ int main(int argc, char **argv) {
     }
 
     // verifying usage is correct
-    bool dev_set = !device_name.empty();
+    bool dev_set = !co.device_names.empty();
     bool port_set = vars_map.count(get_options_long_handle(OPTIONS::PORT));
-    bool url_set = vars_map.count(get_options_long_handle(OPTIONS::URL));
+    bool url_set = !co.urls.empty();
 
-    if (dev_set && url_set) {
-        std::cout << "you can only select one or the other, device stream or url "
-                     "stream, not both"
-                  << std::endl;
+    if (co.device_names.size() + co.urls.size() > camsrv::MAXIMUM_STREAMS) {
+        std::cout << "at most " << camsrv::MAXIMUM_STREAMS << " device nodes and urls can be"
+                  << " selected" << std::endl;
         std::exit(EXIT_FAILURE);
     } else if (!dev_set && !url_set) {
         std::cout << "no device node or url was selected" << std::endl;
@@ -143,13 +195,58 @@ int main(int argc, char **argv) {
         if ((port_number < MIN_PORT) || (port_number > MAX_PORT)) {
             std::cout << "port range must be within " << MIN_PORT << " - " << MAX_PORT << std::endl;
             std::exit(EXIT_FAILURE);
+        } else if ((co.capture.buffer_count < camsrv::MINIMUM_CAPTURE_BUFFER_COUNT) ||
+                   (co.capture.buffer_count > camsrv::MAXIMUM_CAPTURE_BUFFER_COUNT)) {
+            std::cout << "buffers must be within " << camsrv::MINIMUM_CAPTURE_BUFFER_COUNT << " - "
+                      << camsrv::MAXIMUM_CAPTURE_BUFFER_COUNT << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if ((co.encoder_threads < camsrv::MINIMUM_ENCODER_THREAD_COUNT) ||
+                   (co.encoder_threads > camsrv::MAXIMUM_ENCODER_THREAD_COUNT)) {
+            std::cout << "encoder threads must be within " << camsrv::MINIMUM_ENCODER_THREAD_COUNT
+                      << " - " << camsrv::MAXIMUM_ENCODER_THREAD_COUNT << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if (!co.shm_name.empty() && co.shm_name.front() != '/') {
+            std::cout << "shared memory name must start with a '/'" << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if (!co.capture.pixel_format.empty() && co.capture.pixel_format != "mjpeg" &&
+                   co.capture.pixel_format != "yuyv" && co.capture.pixel_format != "nv12") {
+            std::cout << "pixel format must be one of mjpeg, yuyv or nv12" << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if (std::sscanf(resolution.c_str(), "%ux%u", &co.capture.width,
+                               &co.capture.height) != 2 ||
+                   co.capture.width == 0 || co.capture.height == 0 ||
+                   co.capture.width > UINT16_MAX || co.capture.height > UINT16_MAX) {
+            std::cout << "resolution must be given as <width>x<height> (e.g. 640x480)" << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if ((co.capture.fps == 0) || (co.capture.fps > camsrv::MAXIMUM_CAPTURE_FPS)) {
+            std::cout << "fps must be within 1 - " << camsrv::MAXIMUM_CAPTURE_FPS << std::endl;
+            std::exit(EXIT_FAILURE);
+        } else if (co.stats_interval > camsrv::MAXIMUM_STATS_INTERVAL_SECONDS) {
+            std::cout << "stats interval must be within 0 - "
+                      << camsrv::MAXIMUM_STATS_INTERVAL_SECONDS << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        unsigned int http_port = camsrv::DEFAULT_RTSP_HTTP_PORT;
+        if (rtsp_transport == "udp")
+            co.rtsp.transport = camsrv::rtsp_transport_type::UDP;
+        else if (rtsp_transport == "tcp")
+            co.rtsp.transport = camsrv::rtsp_transport_type::TCP;
+        else if (rtsp_transport == "http" ||
+                 (std::sscanf(rtsp_transport.c_str(), "http:%u", &http_port) == 1 &&
+                  http_port > 0 && http_port <= UINT16_MAX)) {
+            co.rtsp.transport = camsrv::rtsp_transport_type::HTTP;
+            co.rtsp.http_port = static_cast<std::uint16_t>(http_port);
+        } else {
+            std::cout << "rtsp transport must be one of udp, tcp or http[:port]" << std::endl;
+            std::exit(EXIT_FAILURE);
         }
     }
 
     boost::asio::io_service io_service;
 
     // creating our camsrv object
-    auto controller = std::make_unique<Controller>(device_name, port_number, url, io_service);
+    auto controller = std::make_unique<Controller>(port_number, co, io_service);
 
     io_service.run();
 
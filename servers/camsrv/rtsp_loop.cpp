@@ -0,0 +1,68 @@
+#include "rtsp_loop.hpp"
+
+// standard includes
+#include <cassert>
+#include <iostream>
+
+Rtsp_Loop::Rtsp_Loop() {
+    scheduler = BasicTaskScheduler::createNew();
+    environment = BasicUsageEnvironment::createNew(*scheduler);
+    post_trigger = scheduler->createEventTrigger(run_posted_tasks);
+}
+
+Rtsp_Loop::~Rtsp_Loop() {
+    stop();
+
+    scheduler->deleteEventTrigger(post_trigger);
+    environment->reclaim();
+    delete scheduler;
+}
+
+void Rtsp_Loop::start() {
+    assert(!thread.joinable());  // sanity check
+    watch_variable = 0;
+    stopping = false;
+    thread = std::thread(std::bind(&Rtsp_Loop::run, this));
+}
+
+void Rtsp_Loop::stop() {
+    if (!thread.joinable()) return;
+
+    // the scheduler only looks at the watch variable between events, so give it one
+    stopping = true;
+    watch_variable = 1;
+    scheduler->triggerEvent(post_trigger, this);
+    thread.join();
+}
+
+void Rtsp_Loop::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+
+    // triggers don't queue up, so the handler runs every task posted since it last ran
+    scheduler->triggerEvent(post_trigger, this);
+}
+
+bool Rtsp_Loop::is_stopping() const { return stopping; }
+
+UsageEnvironment &Rtsp_Loop::get_environment() { return *environment; }
+
+void Rtsp_Loop::run() {
+    std::cout << "rtsp: starting event loop" << std::endl;
+    scheduler->doEventLoop(&watch_variable);
+    std::cout << "rtsp: event loop stopped" << std::endl;
+}
+
+void Rtsp_Loop::run_posted_tasks(void *data) {
+    auto loop = reinterpret_cast<Rtsp_Loop *>(data);
+
+    std::deque<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        pending.swap(loop->tasks);
+    }
+
+    for (auto &t : pending) t();
+}
@@ -0,0 +1,53 @@
+#ifndef rtsp_loop__HPP
+#define rtsp_loop__HPP
+
+// standard includes
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// live555 includes
+#include <BasicUsageEnvironment.hh>
+#include <liveMedia.hh>
+
+// Runs the live555 scheduler every ip camera shares on a thread of its own, so it never holds up
+// the camera service. live555 isn't thread safe, anything touching it from another thread has to
+// be posted onto the loop.
+class Rtsp_Loop {
+public:
+    Rtsp_Loop();
+    ~Rtsp_Loop();
+
+    Rtsp_Loop(const Rtsp_Loop &) = delete;
+    Rtsp_Loop &operator=(const Rtsp_Loop &) = delete;
+
+    void start();
+    void stop();  // returns once the scheduler has stopped, it can be started again
+
+    void post(std::function<void()> task);  // runs task on the loop's thread
+    bool is_stopping() const;               // loop is being stopped on purpose
+
+    UsageEnvironment &get_environment();
+
+private:
+    void run();
+    static void run_posted_tasks(void *data);  // event trigger handler
+
+    // live555 api
+    TaskScheduler *scheduler = nullptr;
+    UsageEnvironment *environment = nullptr;
+
+    // the scheduler runs for as long as the watch variable stays 0
+    std::thread thread;
+    char volatile watch_variable = 0;
+    EventTriggerId post_trigger = 0;  // lets other threads wake the scheduler up right away
+    std::atomic<bool> stopping{false};
+
+    // tasks posted from other threads, guarded by mutex
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+};
+
+#endif
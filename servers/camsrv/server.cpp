@@ -3,21 +3,31 @@
 // standard includes
 #include <iostream>
 
-// opencv include
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgcodecs.hpp>
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
 
-#include "camsrv_msg.hpp"
+#include "defines.hpp"
 
-#define KEEP_ALIVE_TIMOUT_SECONDS 15
-
-Server::Server(boost::asio::io_service& io_service, std::uint16_t p, Stream_Callback sc)
+Server::Server(boost::asio::io_service& io_service, std::uint16_t p,
+               std::shared_ptr<Encoder_Pool> ep, std::vector<std::unique_ptr<Shm_Ring>> sr,
+               Stream_Callback sc, std::uint32_t si)
     : io_service(io_service),
       acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), p)),
       port(p),
-      timer(io_service),
-      stream_callback{sc} {
+      stream_callback{sc},
+      encoder_pool(ep),
+      shm_rings(std::move(sr)),
+      video_decoders(shm_rings.size()),
+      stats(std::make_shared<Pipeline_Stats>()),
+      stats_interval(si),
+      stats_timer(io_service) {
+    for (std::size_t i = 0; i < shm_rings.size(); i++) {
+        video_decode_stats.push_back(std::make_unique<Histogram>());
+        stream_stats.push_back(std::make_unique<Stream_Stats>());
+    }
+
     start_async_accept();  // starting to accept connections
+    if (stats_interval > 0) start_stats_timer();
 }
 
 // opening up our temporary socket connection to start allowing for connections
@@ -25,17 +35,30 @@ void Server::start_async_accept() {
     assert(!temp_socket);  // sanity check
     temp_socket = std::make_unique<boost::asio::ip::tcp::socket>(io_service);
     acceptor.async_accept(*temp_socket, [&](const boost::system::error_code& error) {
-        if (!error) {
-            std::cout << "server: accepted connection on port " << port << std::endl;
-            reset();                          // resetting socket before setting it
-            socket = std::move(temp_socket);  // moving socket so temporary socket can start
-                                              // accepting connections again
-            start_keepalive();                // starting our keepalive timer
-            start_read();                     // starting to read data
+        if (!error && subscribers.size() >= camsrv::MAXIMUM_SUBSCRIBERS) {
+            SLOG_WARNING("server", "refusing connection, already serving too many subscribers",
+                         slog::field("port", port), slog::field("subscribers", subscribers.size()));
+            temp_socket.reset();
+        } else if (!error) {
+            auto id = ++subscriber_count;
+            SLOG_INFO("server", "accepted connection", slog::field("port", port),
+                      slog::field("subscriber", id));
+
+            std::vector<std::string> shm_names;
+            for (const auto& r : shm_rings) shm_names.push_back(r ? r->get_name() : "");
+
+            // moving socket so temporary socket can start accepting connections again
+            auto subscriber = std::make_shared<Subscriber>(
+                std::move(temp_socket), id, std::move(shm_names), stats,
+                std::bind(&Server::update_stream_status, this),
+                std::bind(&Server::remove_subscriber, this, std::placeholders::_1),
+                [this]() { return get_stats().report(); });
+            subscribers.insert(subscriber);
+            subscriber->start();
         } else {
-            std::cerr << "server: attempted to accept connection on port " << port
-                      << " but an error occurred: " << error.message() << std::endl;
-            temp_socket.release();  // just in case
+            SLOG_ERROR("server", "error accepting connection", slog::field("port", port),
+                       slog::field("error", error.message()));
+            temp_socket.reset();  // just in case
         }
 
         // starting to accept connections again now that our connection has been processed
@@ -43,113 +66,172 @@ void Server::start_async_accept() {
     });
 }
 
-void Server::start_read() {
-    assert(socket);  // sanity check
-    boost::asio::async_read(
-        *socket, message_buffer, boost::asio::transfer_exactly(sizeof(camsrv::camsrv_message)),
-        [&](const boost::system::error_code& error, std::size_t bytes_transferred) {
-            if (!error) {
-                if (message_buffer.size() == sizeof(camsrv::camsrv_message)) {
-                    const camsrv::camsrv_message* cm =
-                        boost::asio::buffer_cast<const camsrv::camsrv_message*>(
-                            message_buffer.data());
-
-                    switch (cm->command) {
-                        case camsrv::camsrv_message::camsrv_command::STREAM_ON:
-                            std::cout << "server: received stream on command" << std::endl;
-                            update_stream_status(true);
-                            break;
-                        case camsrv::camsrv_message::camsrv_command::STREAM_OFF:
-                            std::cout << "server: received stream off command" << std::endl;
-                            update_stream_status(false);
-                            break;
-                        case camsrv::camsrv_message::camsrv_command::KEEP_ALIVE:
-                            std::cout << "server: received keepalive" << std::endl;
-                            timer.cancel();  // cancelling keep alive expiration TODO client should
-                                             // be getting keep alive not server
-                            break;
-                        case camsrv::camsrv_message::camsrv_command::IMAGE:
-                        default:  // TODO this should be cerr
-                            std::cout << "server: received unknown command: "
-                                      << static_cast<std::uint32_t>(cm->command) << std::endl;
-                            // disconnecting socket from the server because unknown command was sent
-                            reset();
-                            return;
-                    }
-
-                    reset_buffers();
-                    start_read();
-                } else {
-                    std::cerr << "server: received invalid message size of: " << bytes_transferred
-                              << ", expected: " << sizeof(camsrv::camsrv_message) << std::endl;
-                    reset();
-                }
-            } else {
-                std::cerr << "server: encountered error when reading header: " << error.message()
-                          << std::endl;
-                reset();
-            }
-        });
+void Server::remove_subscriber(std::shared_ptr<Subscriber> subscriber) {
+    SLOG_INFO("server", "subscriber disconnected", slog::field("subscriber", subscriber->get_id()));
+    subscribers.erase(subscriber);
+    update_stream_status();
 }
 
-// resetting the socket
-void Server::reset() {
-    if (socket) {
-        socket->close();
-        socket.release();
+void Server::send_frame(std::uint32_t stream_id, Frame_Ptr frame) {
+    stats->frames_received++;
+    stats->frame_bytes.record(frame->size());
+    if (frame->capture().monotonic_ns) stats->capture.record_since(frame->capture().monotonic_ns);
+
+    // cameras keep sending for a moment after the last subscriber stopped streaming
+    auto targets = stream_targets(stream_id);
+    if (targets.empty()) {
+        stats->frames_unwanted++;
+        decode_video(stream_id, frame, false);
+        return;
     }
-    reset_buffers();
-    update_stream_status(false);
-    timer.cancel();  // cancelling keep alive timer
+
+    bool decode = false;
+    for (const auto& t : targets) {
+        // subscribers can take the camera's frame as is, so there is nothing for us to do
+        if (t.format == frame->format() && !t.max_width && !t.max_height) {
+            fan_out(stream_id, frame, t);
+            continue;
+        }
+
+        // local clients copy the frame straight out of the ring, nothing goes over the socket
+        if (t.format == camsrv::camsrv_message::camsrv_format::SHARED_MEMORY) {
+            shm_rings.at(stream_id)->publish(*frame);
+            continue;
+        }
+
+        // compressed video can be passed on as it is, but we never encode into it
+        if (Frame::is_video(t.format)) {
+            SLOG_ERROR("server", "couldn't send video in another format",
+                       slog::field("stream", stream_id),
+                       slog::field("format", static_cast<std::uint32_t>(t.format)),
+                       slog::field("camera_format", static_cast<std::uint32_t>(frame->format())));
+            continue;
+        }
+
+        // video frames only make sense decoded in order, which is done before they get encoded
+        if (Frame::is_video(frame->format())) {
+            decode = true;
+            continue;
+        }
+
+        encode(stream_id, frame, t);
+    }
+
+    decode_video(stream_id, frame, decode);
+}
+
+std::set<Encode_Target> Server::stream_targets(std::uint32_t stream_id) const {
+    std::set<Encode_Target> targets;
+    for (const auto& s : subscribers) {
+        if (s->is_streaming() && s->get_stream_id() == stream_id) targets.insert(s->get_target());
+    }
+
+    return targets;
 }
 
-// resetting the buffers
-void Server::reset_buffers() { message_buffer.consume(message_buffer.size()); }
-
-void Server::start_keepalive() {
-    std::cout << "server: " << __PRETTY_FUNCTION__ << " called" << std::endl;
-    timer.expires_after(
-        std::chrono::seconds(KEEP_ALIVE_TIMOUT_SECONDS));  // TODO fix spelling of timeout
-    timer.async_wait([&](const boost::system::error_code& error) {
-        if (error == boost::asio::error::operation_aborted && socket)
-            start_keepalive();
-        else if (!error) {
-            std::cerr << "server: did not receive keep-alive within time" << std::endl;
-            reset();
-        } else
-            std::cerr << "server: encountered error while processing keep alive: "
-                      << error.message() << std::endl;  // unknown situation, try to keep going
+void Server::encode(std::uint32_t stream_id, const Frame_Ptr& frame, const Encode_Target& target) {
+    // re-encoding is too slow for our event loop, so it's done by the encoder pool
+    auto id = ++encode_requests;
+    encoder_pool->encode(stream_id, frame, target, [this, id, stream_id, target](Frame_Ptr ef) {
+        // never send a frame older than one we already sent in this format and size
+        auto& last = last_encoded[std::make_pair(stream_id, target)];
+        if (!ef || id < last) return;
+
+        last = id;
+        fan_out(stream_id, ef, target);
     });
 }
 
-void Server::send_frame(std::vector<std::uint8_t> image) {
-    camsrv::camsrv_message cm;
-    if (socket && socket->is_open()) {
-        // decoding mjpeg format
-        cv::Mat cvmat = cv::Mat(image);  // creating mat from image
-        cv::Mat decoded_image = cv::imdecode(cv::Mat(image), cv::IMREAD_COLOR);
-
-        // encoding as png format
-        std::vector<std::uint8_t> encoded_image;
-        cv::imencode(".png", decoded_image, encoded_image);
-
-        // creating commang to go across server
-        cm.command = camsrv::camsrv_message::camsrv_command::IMAGE;
-        cm.size = static_cast<decltype(cm.size)>(encoded_image.size());
-
-        // sending image to socket
-        boost::asio::write(*socket, boost::asio::buffer(reinterpret_cast<char*>(&cm), sizeof(cm)));
-        boost::asio::write(*socket,
-                           boost::asio::buffer(reinterpret_cast<char*>(encoded_image.data()),
-                                               encoded_image.size()));
-    } else
-        std::cerr << "server: couldn't send frame of " << image.size()
-                  << " bytes, not connected to server" << std::endl;
+void Server::decode_video(std::uint32_t stream_id, const Frame_Ptr& frame, bool needed) {
+    // decoding takes a whole core for a big stream, so it stops as soon as nobody needs it
+    auto& decoder = video_decoders.at(stream_id);
+    if (!needed) {
+        if (decoder) video_frames_dropped += decoder->get_frames_dropped();
+        decoder.reset();
+        return;
+    }
+
+    if (!Video_Decoder::is_supported()) {
+        if (!warned_no_video_decoder)
+            SLOG_WARNING("server", "built without libavcodec, video can only be sent as it is",
+                         slog::field("stream", stream_id));
+        warned_no_video_decoder = true;
+        return;
+    }
+
+    if (!decoder) {
+        SLOG_INFO("server", "starting to decode video", slog::field("stream", stream_id));
+        decoder = std::make_unique<Video_Decoder>(
+            io_service, frame->format(),
+            std::bind(&Server::send_decoded_frame, this, stream_id, std::placeholders::_1),
+            *video_decode_stats.at(stream_id));
+    }
+
+    decoder->decode(frame);
+}
+
+void Server::send_decoded_frame(std::uint32_t stream_id, Frame_Ptr frame) {
+    for (const auto& t : stream_targets(stream_id)) {
+        // everyone else already got the camera's frame as it was
+        if (t.format == camsrv::camsrv_message::camsrv_format::SHARED_MEMORY ||
+            Frame::is_video(t.format))
+            continue;
+
+        if (t.format == frame->format() && !t.max_width && !t.max_height)
+            fan_out(stream_id, frame, t);
+        else
+            encode(stream_id, frame, t);
+    }
 }
 
-void Server::update_stream_status(bool status) {
-    streaming = status;
-    stream_callback(streaming);
+void Server::fan_out(std::uint32_t stream_id, const Frame_Ptr& payload,
+                     const Encode_Target& target) {
+    for (const auto& s : subscribers) {
+        if (s->is_streaming() && s->get_stream_id() == stream_id && s->get_target() == target)
+            s->send_frame(payload);
+    }
 }
 
-void Server::request_stream_status_update() { update_stream_status(streaming); }
+void Server::update_stream_status() {
+    std::vector<bool> streaming(shm_rings.size(), false);
+    for (const auto& s : subscribers) {
+        if (s->is_streaming()) streaming.at(s->get_stream_id()) = true;
+    }
+
+    for (std::uint32_t i = 0; i < streaming.size(); i++) stream_callback(i, streaming.at(i));
+}
+
+void Server::request_stream_status_update() { update_stream_status(); }
+
+Stats_Snapshot Server::get_stats() const {
+    Stats_Snapshot snapshot;
+    stats->capture.add_to(snapshot.capture);
+    stats->send.add_to(snapshot.send);
+    stats->frame_bytes.add_to(snapshot.frame_bytes);
+    snapshot.frames_received = stats->frames_received;
+    snapshot.frames_unwanted = stats->frames_unwanted;
+    snapshot.frames_dropped = stats->frames_skipped + video_frames_dropped;
+
+    encoder_pool->add_stats(snapshot);
+    for (const auto& h : video_decode_stats) h->add_to(snapshot.decode);
+    for (const auto& d : video_decoders) {
+        if (d) snapshot.frames_dropped += d->get_frames_dropped();
+    }
+    for (const auto& s : stream_stats) snapshot.streams.push_back(s->snapshot());
+
+    return snapshot;
+}
+
+Stream_Stats& Server::get_stream_stats(std::uint32_t stream_id) const {
+    return *stream_stats.at(stream_id);
+}
+
+void Server::start_stats_timer() {
+    stats_timer.expires_after(std::chrono::seconds(stats_interval));
+    stats_timer.async_wait([this](const boost::system::error_code& error) {
+        if (error) return;
+
+        SLOG_INFO("server", "stats", slog::field("summary", get_stats().summary()));
+        start_stats_timer();
+    });
+}
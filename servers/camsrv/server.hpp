@@ -15,46 +15,95 @@
 #include <boost/signals2.hpp>
 #endif
 
+// standard includes
 #include <iostream>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "camsrv_msg.hpp"
+#include "encoder_pool.hpp"
+#include "frame.hpp"
+#include "shm_ring.hpp"
+#include "stats.hpp"
+#include "subscriber.hpp"
+#include "video_decoder.hpp"
 
 class Server {
 public:
-    using Stream_Callback = std::function<void(bool)>;
-    Server(boost::asio::io_service &io_service, std::uint16_t port, Stream_Callback callback);
+    using Stream_Callback = std::function<void(std::uint32_t stream_id, bool on)>;
+
+    // there's a shared memory ring (or nullptr) for every stream, which tells us how many there
+    // are, a stats line is printed every stats interval seconds unless it's 0
+    Server(boost::asio::io_service &io_service, std::uint16_t port,
+           std::shared_ptr<Encoder_Pool> encoder_pool,
+           std::vector<std::unique_ptr<Shm_Ring>> shm_rings, Stream_Callback callback,
+           std::uint32_t stats_interval);
 
     void request_stream_status_update();
-    void send_frame(std::vector<std::uint8_t> image);
+    void send_frame(std::uint32_t stream_id, Frame_Ptr frame);
+
+    Stats_Snapshot get_stats() const;  // everything measured since we started
+
+    // there's one for every stream from the start, so a camera can get its own from any thread
+    Stream_Stats &get_stream_stats(std::uint32_t stream_id) const;
 
 private:
-    void reset();               // resets socket connection that server was corresponding with
-    void reset_buffers();       // resets buffer stream for received data
+    void start_stats_timer();
+
     void start_async_accept();  // starts listening for new connections on socket
-    void start_keepalive();     // starts keep-alive timer
-    void start_read();
+    void remove_subscriber(std::shared_ptr<Subscriber> subscriber);
+    void update_stream_status();  // a camera streams for as long as any subscriber wants it to
+
+    // formats and sizes wanted from a stream, each gets encoded once no matter how many
+    // subscribers want it
+    std::set<Encode_Target> stream_targets(std::uint32_t stream_id) const;
+    void encode(std::uint32_t stream_id, const Frame_Ptr &frame, const Encode_Target &target);
 
-    void update_stream_status(bool status);
+    // compressed video is decoded for as long as anyone needs it, then encoded like any other frame
+    void decode_video(std::uint32_t stream_id, const Frame_Ptr &frame, bool needed);
+    void send_decoded_frame(std::uint32_t stream_id, Frame_Ptr frame);
 
-    // NOTE: using a temporary socket because we want to keep accepting tcp connections
-    // This is only a one connection allowed server, but due to using different machines
-    // we have run into the issue of deadlocking previously because we do not receive FIN
-    // packet or kill signal. If a new connection kicks old connection off, so be it.
-    std::unique_ptr<boost::asio::ip::tcp::socket> socket;
+    // sends a frame to every streaming subscriber of a stream that wants it in this format and size
+    void fan_out(std::uint32_t stream_id, const Frame_Ptr &payload, const Encode_Target &target);
+
+    // NOTE: using a temporary socket because we want to keep accepting tcp connections while
+    // subscribers are connected. A subscriber that stops sending keep-alives (e.g. because we
+    // never received its FIN packet) gets dropped by its own keep-alive timer.
     std::unique_ptr<boost::asio::ip::tcp::socket> temp_socket;
+    std::set<std::shared_ptr<Subscriber>> subscribers;
+    std::uint32_t subscriber_count = 0;  // number of subscribers ever accepted, used for ids
 
     // asio objects
     boost::asio::io_service &io_service;
     boost::asio::ip::tcp::acceptor acceptor;
 
-    // keep-alive
-    boost::asio::steady_timer timer;  // keep-alive timer
-
-    boost::asio::streambuf message_buffer;
     const std::uint16_t port;
 
     Stream_Callback stream_callback;
 
-    bool server_started = false;
-    bool streaming = false;
+    // re-encoding frames, results can come back out of order so older ones get thrown away
+    std::shared_ptr<Encoder_Pool> encoder_pool;
+    std::uint64_t encode_requests = 0;  // id of the latest frame handed to the encoder pool
+    std::map<std::pair<std::uint32_t, Encode_Target>, std::uint64_t>
+        last_encoded;  // id of the latest encoded frame sent out per stream, format and size
+
+    // one per camera, local clients read frames from here, null if disabled
+    std::vector<std::unique_ptr<Shm_Ring>> shm_rings;
+
+    // one per camera, only there while a camera's video is being decoded
+    std::vector<std::unique_ptr<Video_Decoder>> video_decoders;
+    bool warned_no_video_decoder = false;
+
+    // what every stage of the pipeline costs, subscribers record what they send into it
+    std::shared_ptr<Pipeline_Stats> stats;
+    // one per camera, a camera's video decoders come and go but only one is ever recording
+    std::vector<std::unique_ptr<Histogram>> video_decode_stats;
+    std::vector<std::unique_ptr<Stream_Stats>> stream_stats;  // one per camera, recorded by it
+    std::uint64_t video_frames_dropped = 0;  // by video decoders that are gone
+    const std::uint32_t stats_interval;
+    boost::asio::steady_timer stats_timer;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,110 @@
+// A minimal local client of the shared memory frame ring. It maps the ring read only, the way
+// camsrv_shm.hpp says clients have to, and prints every frame it manages to read. Handy for
+// checking a ring from the command line, the ring's name is the one SHM_INFO replies with.
+
+// c includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// standard includes
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camsrv_shm.hpp"
+
+namespace {
+const long WAIT_TIMEOUT_MS = 1000;  // how long to sleep before looking at the ring again anyway
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <ring name> [frames, 0 reads forever]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string name = argv[1];
+    std::uint64_t frames = argc > 2 ? std::stoull(argv[2]) : 0;
+
+    auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        std::cerr << "shm reader: could not open " << name << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < 64) {
+        std::cerr << "shm reader: " << name << " is not a frame ring" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto res = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // mapping keeps the shared memory alive
+    if (res == MAP_FAILED) {
+        std::cerr << "shm reader: mapping " << name << " failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // camsrv only sets the magic once the rest of the header is filled in
+    auto ring = static_cast<const camsrv::shm_ring_header *>(res);
+    auto magic = ring->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != camsrv::SHM_RING_MAGIC || ring->version != camsrv::SHM_RING_VERSION ||
+        static_cast<std::size_t>(st.st_size) <
+            camsrv::shm_ring_size(ring->slot_count, ring->slot_size)) {
+        std::cerr << "shm reader: " << name << " is not a version " << camsrv::SHM_RING_VERSION
+                  << " frame ring" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "shm reader: reading " << name << " (" << ring->slot_count << " slots of "
+              << ring->slot_size << " bytes)" << std::endl;
+
+    // frames are copied out of their slot, the slot may be written over as soon as we're done
+    std::vector<std::uint8_t> frame;
+    frame.reserve(ring->slot_size);
+    std::uint64_t last_frame_number = 0;
+    std::uint64_t frames_read = 0;
+    std::uint64_t frames_torn = 0;  // written over while we were copying them
+    while (frames == 0 || frames_read < frames) {
+        auto seen_count = ring->publish_count.load(std::memory_order_acquire);
+
+        std::uint64_t frame_number = 0;
+        std::uint32_t format = 0;
+        std::uint16_t width = 0, height = 0;
+        std::uint64_t capture_sequence = 0;
+        auto read = camsrv::shm_read_latest(
+            ring, [&](const std::uint8_t *data, const camsrv::shm_slot_header &slot) {
+                auto size = std::min(slot.size, ring->slot_size);
+                frame.assign(data, data + size);
+                frame_number = slot.frame_number;
+                format = static_cast<std::uint32_t>(slot.format);
+                width = slot.width;
+                height = slot.height;
+                capture_sequence = slot.capture_sequence;
+            });
+
+        if (!read && frame_number != 0)
+            frames_torn++;
+        else if (read && frame_number != last_frame_number) {
+            std::cout << "frame " << frame_number << ": " << frame.size() << " bytes, format "
+                      << format << ", " << width << "x" << height << ", captured "
+                      << capture_sequence << std::endl;
+            last_frame_number = frame_number;
+            frames_read++;
+            continue;  // another frame may already be waiting
+        }
+
+        camsrv::shm_wait(ring, seen_count, WAIT_TIMEOUT_MS);
+    }
+
+    std::cout << "shm reader: read " << frames_read << " frames, " << frames_torn
+              << " written over while reading" << std::endl;
+    munmap(res, st.st_size);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include "shm_ring.hpp"
+
+// c includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// standard includes
+#include <cstring>
+#include <iostream>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+Shm_Ring::Shm_Ring(std::string n, std::uint32_t slot_count, std::uint32_t slot_size)
+    : name(n), ring_size(camsrv::shm_ring_size(slot_count, slot_size)) {
+    auto fd = shm_open(name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+        std::cerr << "shm: could not open shared memory " << name << ": " << strerror(errno)
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd, ring_size) == -1) {
+        std::cerr << "shm: could not size shared memory " << name << ": " << strerror(errno)
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto res = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);  // mapping keeps the shared memory alive
+    if (res == MAP_FAILED) {
+        std::cerr << "shm: mapping " << name << " failed" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    // a previous camsrv may have left frames behind, clients should never see those
+    std::memset(res, 0, ring_size);
+    ring = static_cast<camsrv::shm_ring_header *>(res);
+    ring->version = camsrv::SHM_RING_VERSION;
+    ring->slot_count = slot_count;
+    ring->slot_size = slot_size;
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = camsrv::SHM_RING_MAGIC;
+
+    std::cout << "shm: publishing frames to " << name << " (" << slot_count << " slots of "
+              << slot_size << " bytes)" << std::endl;
+}
+
+Shm_Ring::~Shm_Ring() {
+    munmap(ring, ring_size);
+    shm_unlink(name.c_str());
+}
+
+void Shm_Ring::publish(const Frame &frame) {
+    if (frame.size() > ring->slot_size) {
+        if (frames_too_big++ == 0)
+            SLOG_WARNING("shm", "frame doesn't fit in a slot, skipping frames like it",
+                         slog::field("size", frame.size()),
+                         slog::field("slot_size", ring->slot_size));
+        return;
+    }
+
+    auto fn = ++frame_number;
+    auto slot = camsrv::shm_slot(ring, fn);
+
+    // odd sequence tells readers the slot is being written
+    auto sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(const_cast<std::uint8_t *>(camsrv::shm_slot_data(slot)), frame.data(),
+                frame.size());
+    slot->size = static_cast<std::uint32_t>(frame.size());
+    slot->frame_number = fn;
+    slot->format = frame.format();
+    slot->width = frame.width();
+    slot->height = frame.height();
+    slot->capture_sequence = frame.capture().sequence;
+    slot->capture_monotonic_ns = frame.capture().monotonic_ns;
+    slot->capture_wall_ns = frame.capture().wall_ns;
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    ring->latest.store(fn, std::memory_order_release);
+
+    // clients map the ring read only so they can't tell us they're asleep, waking nobody is only
+    // a system call per frame
+    ring->publish_count.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&ring->publish_count), FUTEX_WAKE,
+            INT_MAX, nullptr, nullptr, 0);
+}
+
+std::string Shm_Ring::get_name() const { return name; }
@@ -0,0 +1,31 @@
+#ifndef shm_ring__HPP
+#define shm_ring__HPP
+
+// standard includes
+#include <cstdint>
+#include <string>
+
+#include "camsrv_shm.hpp"
+#include "frame.hpp"
+
+// Owns the shared memory frame ring local clients read frames from (see camsrv_shm.hpp). Frames
+// are copied into the ring once, however many local clients are reading it.
+class Shm_Ring {
+public:
+    Shm_Ring(std::string name, std::uint32_t slot_count, std::uint32_t slot_size);
+    ~Shm_Ring();
+
+    void publish(const Frame &frame);  // frames are published in whatever format they are in
+
+    std::string get_name() const;
+
+private:
+    const std::string name;
+    camsrv::shm_ring_header *ring = nullptr;
+    std::size_t ring_size;
+
+    std::uint64_t frame_number = 0;    // frame number of the last frame published
+    std::uint64_t frames_too_big = 0;  // frames that didn't fit in a slot
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "stats.hpp"
+
+// standard includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// c includes
+#include <time.h>
+
+namespace {
+// stages are reported in microseconds, anything finer is noise
+void print_stage(std::ostream &os, const char *name, const Histogram_Snapshot &stage) {
+    os << std::setw(11) << std::left << name << std::right << std::setw(10) << stage.count
+       << " frames";
+    if (stage.count == 0) {
+        os << "\n";
+        return;
+    }
+
+    os << ", p50 " << stage.percentile(50) / 1000 << " us, p90 " << stage.percentile(90) / 1000
+       << " us, p99 " << stage.percentile(99) / 1000 << " us, p99.9 "
+       << stage.percentile(99.9) / 1000 << " us, max " << stage.max / 1000 << " us\n";
+}
+
+double encode_ratio(const Stats_Snapshot &snapshot) {
+    if (snapshot.encoder_bytes_in == 0) return 0;
+    return static_cast<double>(snapshot.encoder_bytes_out) / snapshot.encoder_bytes_in;
+}
+}  // namespace
+
+std::uint64_t Histogram_Snapshot::percentile(double p) const {
+    if (count == 0) return 0;
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(p / 100 * count));
+    if (rank == 0) rank = 1;
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(bucket_highest_value(i), max);
+    }
+
+    return max;  // only if buckets and count were snapshotted while a value was being recorded
+}
+
+std::uint64_t Histogram_Snapshot::mean() const { return count ? sum / count : 0; }
+
+std::size_t Histogram_Snapshot::bucket_index(std::uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) return static_cast<std::size_t>(value);
+
+    // the highest bit picks the power of two, the bits below it pick the bucket within it
+    std::size_t magnitude = 63 - __builtin_clzll(value);
+    std::size_t shift = magnitude - SUB_BUCKET_BITS;
+    std::size_t sub_bucket = (value >> shift) & (SUB_BUCKET_COUNT - 1);
+    return SUB_BUCKET_COUNT * (shift + 1) + sub_bucket;
+}
+
+std::uint64_t Histogram_Snapshot::bucket_highest_value(std::size_t index) {
+    if (index < SUB_BUCKET_COUNT) return index;
+
+    std::size_t shift = index / SUB_BUCKET_COUNT - 1;
+    std::uint64_t lowest = static_cast<std::uint64_t>(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT)
+                           << shift;
+    return lowest + ((std::uint64_t{1} << shift) - 1);
+}
+
+std::string Stats_Snapshot::report() const {
+    std::ostringstream os;
+    os << "frames received " << frames_received << ", unwanted " << frames_unwanted
+       << ", dropped " << frames_dropped << "\n";
+    os << "bytes per frame mean " << frame_bytes.mean() << ", p50 " << frame_bytes.percentile(50)
+       << ", p99 " << frame_bytes.percentile(99) << ", max " << frame_bytes.max << "\n";
+    os << "encode ratio " << std::fixed << std::setprecision(3) << encode_ratio(*this) << " ("
+       << encoder_bytes_in << " bytes in, " << encoder_bytes_out << " bytes out)\n";
+
+    print_stage(os, "capture", capture);
+    print_stage(os, "queue wait", queue_wait);
+    print_stage(os, "decode", decode);
+    print_stage(os, "encode", encode);
+    print_stage(os, "send", send);
+
+    for (std::size_t i = 0; i < streams.size(); i++) {
+        const auto &s = streams[i];
+        os << "stream " << i << " rtp packets " << s.rtp_packets_received << ", lost "
+           << s.rtp_packets_lost << ", jitter " << s.rtp_jitter_us << " us, reconnects "
+           << s.rtp_reconnects << ", truncated " << s.frames_truncated << " frames ("
+           << s.bytes_truncated << " bytes), discarded " << s.frames_discarded << " frames ("
+           << s.bytes_discarded << " bytes), pauses " << s.pauses << ", idle teardowns "
+           << s.idle_teardowns << "\n";
+    }
+    return os.str();
+}
+
+std::string Stats_Snapshot::summary() const {
+    std::ostringstream os;
+    os << "stats: " << frames_received << " frames (" << frames_dropped << " dropped, "
+       << frames_unwanted << " unwanted), " << frame_bytes.mean() << " bytes per frame, p99 us"
+       << " capture " << capture.percentile(99) / 1000 << " queue "
+       << queue_wait.percentile(99) / 1000 << " decode " << decode.percentile(99) / 1000
+       << " encode " << encode.percentile(99) / 1000 << " send " << send.percentile(99) / 1000
+       << ", encode ratio " << std::fixed << std::setprecision(3) << encode_ratio(*this);
+    return os.str();
+}
+
+Stream_Stats_Snapshot Stream_Stats::snapshot() const {
+    Stream_Stats_Snapshot s;
+    s.frames_truncated = frames_truncated.load(std::memory_order_relaxed);
+    s.bytes_truncated = bytes_truncated.load(std::memory_order_relaxed);
+    s.frames_discarded = frames_discarded.load(std::memory_order_relaxed);
+    s.bytes_discarded = bytes_discarded.load(std::memory_order_relaxed);
+    s.pauses = pauses.load(std::memory_order_relaxed);
+    s.idle_teardowns = idle_teardowns.load(std::memory_order_relaxed);
+    s.rtp_packets_received = rtp_packets_received.load(std::memory_order_relaxed);
+    s.rtp_packets_lost = rtp_packets_lost.load(std::memory_order_relaxed);
+    s.rtp_jitter_us = rtp_jitter_us.load(std::memory_order_relaxed);
+    s.rtp_reconnects = rtp_reconnects.load(std::memory_order_relaxed);
+    return s;
+}
+
+void Histogram::record(std::uint64_t value) {
+    // nothing here needs ordering, a snapshot only has to add up eventually
+    buckets[Histogram_Snapshot::bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    auto current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+void Histogram::record_since(std::int64_t start_ns) {
+    auto elapsed = now_ns() - start_ns;
+    record(elapsed > 0 ? static_cast<std::uint64_t>(elapsed) : 0);
+}
+
+void Histogram::add_to(Histogram_Snapshot &snapshot) const {
+    for (std::size_t i = 0; i < buckets.size(); i++)
+        snapshot.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+    snapshot.count += count.load(std::memory_order_relaxed);
+    snapshot.sum += sum.load(std::memory_order_relaxed);
+    snapshot.max = std::max(snapshot.max, max.load(std::memory_order_relaxed));
+}
+
+std::int64_t Histogram::now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
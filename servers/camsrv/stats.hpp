@@ -0,0 +1,119 @@
+#ifndef stats__HPP
+#define stats__HPP
+
+// standard includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything a histogram has counted up to some point, histograms of several threads get added
+// into one snapshot to be reported together.
+struct Histogram_Snapshot {
+    static constexpr std::size_t SUB_BUCKET_BITS = 4;  // values within 1/16th share a bucket
+    static constexpr std::size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (64 - SUB_BUCKET_BITS + 1);
+
+    std::array<std::uint64_t, BUCKET_COUNT> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+
+    std::uint64_t percentile(double p) const;  // largest value the p'th percentile could be
+    std::uint64_t mean() const;
+
+    static std::size_t bucket_index(std::uint64_t value);
+    static std::uint64_t bucket_highest_value(std::size_t index);
+};
+
+// Counts values the way an hdr histogram does, exact up to 16 and within 1/16th of the value above
+// that, so nanoseconds and bytes can be counted in the same fixed number of buckets. Recording is
+// lock free and never allocates, every histogram is meant to have a single thread recording into
+// it so threads never fight over the same cache lines. Any thread can take a snapshot.
+class Histogram {
+public:
+    void record(std::uint64_t value);
+    void record_since(std::int64_t start_ns);  // nanoseconds from start to now
+
+    void add_to(Histogram_Snapshot &snapshot) const;
+
+    static std::int64_t now_ns();  // CLOCK_MONOTONIC, same as a frame's capture time
+
+private:
+    std::array<std::atomic<std::uint64_t>, Histogram_Snapshot::BUCKET_COUNT> buckets{};
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+};
+
+// What the server's own thread measures of every frame, subscribers record into it too since they
+// run on the same thread.
+struct Pipeline_Stats {
+    Histogram capture;      // from the camera capturing a frame to the server getting it
+    Histogram send;         // writing a frame to a client's socket
+    Histogram frame_bytes;  // frames as the cameras sent them
+
+    std::atomic<std::uint64_t> frames_received{0};
+    std::atomic<std::uint64_t> frames_unwanted{0};  // came in while no subscriber was streaming
+    std::atomic<std::uint64_t> frames_skipped{0};   // replaced before a client could be sent them
+};
+
+// What a camera counts of its own stream so far, only ip cameras count any of it.
+struct Stream_Stats_Snapshot {
+    std::uint64_t frames_truncated = 0;  // didn't fit the buffer they were received into
+    std::uint64_t bytes_truncated = 0;
+    std::uint64_t frames_discarded = 0;  // arrived while nobody was streaming
+    std::uint64_t bytes_discarded = 0;
+    std::uint64_t pauses = 0;
+    std::uint64_t idle_teardowns = 0;
+
+    // how well rtp is getting through from the camera, packet counts are for the current session
+    std::uint64_t rtp_packets_received = 0;
+    std::uint64_t rtp_packets_lost = 0;  // expected going by sequence numbers, but never received
+    std::uint64_t rtp_jitter_us = 0;     // interarrival jitter
+    std::uint64_t rtp_reconnects = 0;    // times the stream had to be set up again
+};
+
+// There's one for every stream, its camera records into it from whatever thread the camera runs
+// on and any thread can take a snapshot.
+struct Stream_Stats {
+    std::atomic<std::uint64_t> frames_truncated{0};
+    std::atomic<std::uint64_t> bytes_truncated{0};
+    std::atomic<std::uint64_t> frames_discarded{0};
+    std::atomic<std::uint64_t> bytes_discarded{0};
+    std::atomic<std::uint64_t> pauses{0};
+    std::atomic<std::uint64_t> idle_teardowns{0};
+
+    std::atomic<std::uint64_t> rtp_packets_received{0};
+    std::atomic<std::uint64_t> rtp_packets_lost{0};
+    std::atomic<std::uint64_t> rtp_jitter_us{0};
+    std::atomic<std::uint64_t> rtp_reconnects{0};
+
+    Stream_Stats_Snapshot snapshot() const;
+};
+
+// Where the time went between a camera capturing frames and clients getting them, gathered from
+// every thread's histograms.
+struct Stats_Snapshot {
+    // nanoseconds spent on every stage a frame can go through
+    Histogram_Snapshot capture;
+    Histogram_Snapshot queue_wait;  // waiting on an encoder thread
+    Histogram_Snapshot decode;      // decoding, video frames included
+    Histogram_Snapshot encode;
+    Histogram_Snapshot send;
+
+    Histogram_Snapshot frame_bytes;
+    std::uint64_t frames_received = 0;
+    std::uint64_t frames_unwanted = 0;
+    std::uint64_t frames_dropped = 0;  // by the encoders, video decoders and clients
+    std::uint64_t encoder_bytes_in = 0;
+    std::uint64_t encoder_bytes_out = 0;
+
+    std::vector<Stream_Stats_Snapshot> streams;  // indexed by stream id
+
+    std::string report() const;   // one line per stage, what the stats command replies with
+    std::string summary() const;  // a single line
+};
+
+#endif
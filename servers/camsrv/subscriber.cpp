@@ -0,0 +1,369 @@
+#include "subscriber.hpp"
+
+// standard includes
+#include <cstring>
+#include <iostream>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+#include "defines.hpp"
+
+#define KEEP_ALIVE_TIMOUT_SECONDS 15
+
+Subscriber::Subscriber(std::unique_ptr<boost::asio::ip::tcp::socket> s, std::uint32_t i,
+                       std::vector<std::string> sn, std::shared_ptr<Pipeline_Stats> ps,
+                       Status_Callback sc, Closed_Callback cc, Stats_Callback stc)
+    : socket(std::move(s)),
+      timer(socket->get_executor()),
+      video_frames(camsrv::VIDEO_QUEUE_SIZE),
+      id(i),
+      shm_names(sn),
+      stats(ps),
+      status_callback{sc},
+      closed_callback{cc},
+      stats_callback{stc} {}
+
+void Subscriber::start() {
+    start_keepalive();  // starting our keepalive timer
+    start_read();       // starting to read data
+}
+
+void Subscriber::start_read() {
+    boost::asio::async_read(
+        *socket, message_buffer, boost::asio::transfer_exactly(message_size),
+        [&, self = shared_from_this()](const boost::system::error_code& error,
+                                       std::size_t bytes_transferred) {
+            if (closed) return;
+
+            if (!error) {
+                if (message_buffer.size() == message_size) {
+                    // legacy messages leave the rest of the message at its defaults
+                    camsrv::camsrv_message message;
+                    std::memcpy(&message,
+                                boost::asio::buffer_cast<const void*>(message_buffer.data()),
+                                message_size);
+                    const camsrv::camsrv_message* cm = &message;
+
+                    // every command but keep-alives picks the camera the client is following
+                    if (cm->command != camsrv::camsrv_message::camsrv_command::KEEP_ALIVE &&
+                        !select_stream(cm->stream_id)) {
+                        close();
+                        return;
+                    }
+
+                    switch (cm->command) {
+                        case camsrv::camsrv_message::camsrv_command::HELLO: {
+                            SLOG_INFO("subscriber", "received hello command",
+                                      slog::field("id", id));
+                            // anything already on its way would be cut short of what the client
+                            // is expecting from now on
+                            if (message_size != camsrv::LEGACY_MESSAGE_SIZE || streaming ||
+                                writing) {
+                                SLOG_ERROR("subscriber", "hello has to come first",
+                                           slog::field("id", id));
+                                close();
+                                return;
+                            }
+
+                            message_size = sizeof(camsrv::camsrv_message);
+                            camsrv::camsrv_message reply;
+                            reply.command = camsrv::camsrv_message::camsrv_command::HELLO;
+                            reply.stream_id = stream_id;
+                            send_reply(reply, std::make_shared<const Frame>(
+                                                  std::vector<std::uint8_t>()));
+                            break;
+                        }
+                        case camsrv::camsrv_message::camsrv_command::STREAM_ON:
+                            SLOG_INFO("subscriber", "received stream on command",
+                                      slog::field("id", id));
+                            update_stream_status(true);
+                            break;
+                        case camsrv::camsrv_message::camsrv_command::STREAM_OFF:
+                            SLOG_INFO("subscriber", "received stream off command",
+                                      slog::field("id", id));
+                            update_stream_status(false);
+                            break;
+                        case camsrv::camsrv_message::camsrv_command::SET_FORMAT:
+                            SLOG_INFO("subscriber", "received set format command",
+                                      slog::field("id", id),
+                                      slog::field("format", static_cast<std::uint32_t>(cm->format)),
+                                      slog::field("width", cm->width),
+                                      slog::field("height", cm->height));
+                            if (!update_format(*cm)) {
+                                // disconnecting socket, client and server can't agree on format
+                                close();
+                                return;
+                            }
+                            break;
+                        case camsrv::camsrv_message::camsrv_command::SHM_INFO: {
+                            SLOG_INFO("subscriber", "received shm info command",
+                                      slog::field("id", id));
+                            // replying with the ring's name, an empty name means there is no ring
+                            camsrv::camsrv_message reply;
+                            const auto& shm_name = shm_names.at(stream_id);
+                            reply.command = camsrv::camsrv_message::camsrv_command::SHM_INFO;
+                            reply.size = static_cast<decltype(reply.size)>(shm_name.size());
+                            reply.stream_id = stream_id;
+                            std::vector<std::uint8_t> name(shm_name.begin(), shm_name.end());
+                            send_reply(reply, std::make_shared<const Frame>(std::move(name)));
+                            break;
+                        }
+                        case camsrv::camsrv_message::camsrv_command::STATS: {
+                            // replying with the report as text, the same way shm info does
+                            auto report = stats_callback();
+                            camsrv::camsrv_message reply;
+                            reply.command = camsrv::camsrv_message::camsrv_command::STATS;
+                            reply.size = static_cast<decltype(reply.size)>(report.size());
+                            reply.stream_id = stream_id;
+                            std::vector<std::uint8_t> text(report.begin(), report.end());
+                            send_reply(reply, std::make_shared<const Frame>(std::move(text)));
+                            break;
+                        }
+                        case camsrv::camsrv_message::camsrv_command::KEEP_ALIVE:
+                            // far too frequent to be worth printing
+                            timer.cancel();  // cancelling keep alive expiration TODO client should
+                                             // be getting keep alive not server
+                            break;
+                        case camsrv::camsrv_message::camsrv_command::IMAGE:
+                        default:
+                            SLOG_ERROR(
+                                "subscriber", "received unknown command", slog::field("id", id),
+                                slog::field("command", static_cast<std::uint32_t>(cm->command)));
+                            // disconnecting socket from the server because unknown command was sent
+                            close();
+                            return;
+                    }
+
+                    reset_buffers();
+                    start_read();
+                } else {
+                    SLOG_ERROR("subscriber", "received invalid message size",
+                               slog::field("id", id), slog::field("size", bytes_transferred),
+                               slog::field("expected", message_size));
+                    close();
+                }
+            } else {
+                SLOG_ERROR("subscriber", "encountered error when reading header",
+                           slog::field("id", id), slog::field("error", error.message()));
+                close();
+            }
+        });
+}
+
+// closing the socket
+void Subscriber::close() {
+    if (closed) return;
+    closed = true;
+
+    boost::system::error_code ec;
+    socket->close(ec);  // nothing we could do about an error anyway
+    timer.cancel();     // cancelling keep alive timer
+    reset_buffers();
+
+    // anything still waiting to be written was meant for this connection
+    auto skipped = frames_skipped + video_frames.get_frames_dropped();
+    if (skipped > 0)
+        SLOG_INFO("subscriber", "skipped frames waiting on the client", slog::field("id", id),
+                  slog::field("skipped", skipped));
+    pending_frame.reset();
+    pending_replies.clear();
+    video_frames.restart();
+
+    streaming = false;
+    closed_callback(shared_from_this());
+}
+
+// resetting the buffers
+void Subscriber::reset_buffers() { message_buffer.consume(message_buffer.size()); }
+
+void Subscriber::start_keepalive() {
+    timer.expires_after(
+        std::chrono::seconds(KEEP_ALIVE_TIMOUT_SECONDS));  // TODO fix spelling of timeout
+    timer.async_wait([&, self = shared_from_this()](const boost::system::error_code& error) {
+        if (closed) return;
+
+        if (error == boost::asio::error::operation_aborted)
+            start_keepalive();
+        else if (!error) {
+            SLOG_WARNING("subscriber", "did not receive keep-alive within time",
+                         slog::field("id", id));
+            close();
+        } else
+            // unknown situation, try to keep going
+            SLOG_ERROR("subscriber", "encountered error while processing keep alive",
+                       slog::field("id", id), slog::field("error", error.message()));
+    });
+}
+
+void Subscriber::send_frame(Frame_Ptr payload) {
+    if (closed) return;
+
+    // video frames need the ones before them, the queue decides which of those can be dropped
+    if (Frame::is_video(payload->format())) {
+        auto dropped = video_frames.get_frames_dropped();
+        video_frames.push(std::move(payload));
+        stats->frames_skipped += video_frames.get_frames_dropped() - dropped;
+        if (!writing) write_next();
+        return;
+    }
+
+    // a slow client must never hold up the server, so rather than queuing frames behind the write
+    // in flight, only the newest frame is kept around to be sent next
+    if (writing) {
+        if (pending_frame) {
+            frames_skipped++;
+            stats->frames_skipped++;
+        }
+        pending_frame = std::move(payload);
+        return;
+    }
+
+    auto header = image_header(*payload);  // before the payload is moved out from under it
+    start_write(header, std::move(payload));
+}
+
+camsrv::camsrv_message Subscriber::image_header(const Frame& frame) const {
+    // creating command to go across server
+    camsrv::camsrv_message cm;
+    cm.command = camsrv::camsrv_message::camsrv_command::IMAGE;
+    cm.format = frame.format();
+    cm.size = static_cast<decltype(cm.size)>(frame.size());
+    cm.width = frame.width();
+    cm.height = frame.height();
+    cm.stream_id = stream_id;
+    cm.sequence = static_cast<decltype(cm.sequence)>(frame.capture().sequence);
+    cm.timestamp_monotonic_ns = frame.capture().monotonic_ns;
+    cm.timestamp_wall_ns = frame.capture().wall_ns;
+    return cm;
+}
+
+void Subscriber::send_reply(camsrv::camsrv_message header, Frame_Ptr payload) {
+    if (closed) return;
+
+    pending_replies.emplace_back(header, std::move(payload));
+    if (!writing) write_next();
+}
+
+void Subscriber::write_next() {
+    // replies go first, a client is waiting on those and they are never skipped
+    if (!pending_replies.empty()) {
+        auto reply = std::move(pending_replies.front());
+        pending_replies.pop_front();
+        start_write(reply.first, std::move(reply.second));
+    } else if (pending_frame) {
+        auto header = image_header(*pending_frame);
+        start_write(header, std::move(pending_frame));
+    } else if (auto frame = video_frames.pop()) {
+        auto header = image_header(*frame);
+        start_write(header, std::move(frame));
+    }
+}
+
+void Subscriber::start_write(camsrv::camsrv_message header, Frame_Ptr payload) {
+    assert(!writing);  // sanity check
+    writing = true;
+    write_header = header;
+    write_started_ns = Histogram::now_ns();
+
+    // sending header and payload to socket in one go, the payload is kept alive by the handler
+    std::array<boost::asio::const_buffer, 2> buffers = {
+        boost::asio::buffer(&write_header, message_size),
+        boost::asio::buffer(payload->data(), payload->size())};
+    boost::asio::async_write(*socket, buffers,
+                             [&, self = shared_from_this(), payload](
+                                 const boost::system::error_code& error, std::size_t) {
+                                 writing = false;
+                                 if (closed) return;
+
+                                 // replies are only a few bytes, they'd skew what frames cost
+                                 if (write_header.command ==
+                                     camsrv::camsrv_message::camsrv_command::IMAGE)
+                                     stats->send.record_since(write_started_ns);
+
+                                 if (error) {
+                                     SLOG_ERROR("subscriber", "encountered error when writing",
+                                                slog::field("id", id),
+                                                slog::field("error", error.message()));
+                                     close();
+                                 } else
+                                     write_next();
+                             });
+}
+
+void Subscriber::update_stream_status(bool status) {
+    if (status && !streaming) video_frames.restart();  // can only start on a key frame
+    streaming = status;
+    status_callback();
+}
+
+bool Subscriber::select_stream(std::uint32_t requested_stream_id) {
+    if (requested_stream_id >= shm_names.size()) {
+        SLOG_ERROR("subscriber", "client requested unknown stream", slog::field("id", id),
+                   slog::field("stream", requested_stream_id));
+        return false;
+    } else if (requested_stream_id == stream_id)
+        return true;
+
+    SLOG_INFO("subscriber", "switching stream", slog::field("id", id),
+              slog::field("stream", requested_stream_id));
+    stream_id = requested_stream_id;
+    pending_frame.reset();  // belongs to the stream we just left
+    video_frames.restart();
+    status_callback();
+    return true;
+}
+
+bool Subscriber::update_format(const camsrv::camsrv_message& request) {
+    switch (request.format) {
+        case camsrv::camsrv_message::camsrv_format::PNG:
+        case camsrv::camsrv_message::camsrv_format::JPEG:
+        case camsrv::camsrv_message::camsrv_format::BGR:
+            target = {request.format, request.width, request.height};
+            status_callback();
+            return true;
+        case camsrv::camsrv_message::camsrv_format::SHARED_MEMORY:
+            if (shm_names.at(stream_id).empty()) {
+                SLOG_ERROR("subscriber", "client requested shared memory but there is no ring",
+                           slog::field("id", id));
+                return false;
+            }
+
+            target = {request.format, 0, 0};  // ring gets the camera's frames as they are
+            status_callback();
+            return true;
+        case camsrv::camsrv_message::camsrv_format::H264:
+        case camsrv::camsrv_message::camsrv_format::H265:
+            if (request.width || request.height) {
+                // compressed video is only ever sent as the camera sent it
+                SLOG_ERROR("subscriber", "client requested a maximum size for compressed video",
+                           slog::field("id", id));
+                return false;
+            }
+
+            target = {request.format, 0, 0};
+            video_frames.restart();  // frames of another format might be queued up
+            status_callback();
+            return true;
+        case camsrv::camsrv_message::camsrv_format::YUYV:
+        case camsrv::camsrv_message::camsrv_format::NV12:
+            // those are only published to the shared memory ring
+            SLOG_ERROR("subscriber", "client requested a camera format", slog::field("id", id),
+                       slog::field("format", static_cast<std::uint32_t>(request.format)));
+            return false;
+        default:
+            SLOG_ERROR("subscriber", "client requested unknown format", slog::field("id", id),
+                       slog::field("format", static_cast<std::uint32_t>(request.format)));
+            return false;
+    }
+}
+
+bool Subscriber::is_streaming() const { return streaming; }
+
+camsrv::camsrv_message::camsrv_format Subscriber::get_format() const { return target.format; }
+
+Encode_Target Subscriber::get_target() const { return target; }
+
+std::uint32_t Subscriber::get_stream_id() const { return stream_id; }
+
+std::uint32_t Subscriber::get_id() const { return id; }
@@ -0,0 +1,90 @@
+#ifndef subscriber__HPP
+#define subscriber__HPP
+
+// standard includes
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/asio.hpp>
+
+#include "camsrv_msg.hpp"
+#include "encoder_pool.hpp"
+#include "frame.hpp"
+#include "stats.hpp"
+#include "video_queue.hpp"
+
+// A single client connected to the server. Every subscriber has its own keep-alive, its own format
+// and stream on/off choice, and its own send queue so one slow client never holds up the others.
+class Subscriber : public std::enable_shared_from_this<Subscriber> {
+public:
+    using Status_Callback = std::function<void()>;  // stream status or format has changed
+    using Closed_Callback = std::function<void(std::shared_ptr<Subscriber>)>;
+    using Stats_Callback = std::function<std::string()>;  // report the client asked for
+    Subscriber(std::unique_ptr<boost::asio::ip::tcp::socket> socket, std::uint32_t id,
+               std::vector<std::string> shm_names, std::shared_ptr<Pipeline_Stats> stats,
+               Status_Callback status_callback, Closed_Callback closed_callback,
+               Stats_Callback stats_callback);
+
+    void start();  // starts keep-alive and reading commands, must be called once after creation
+    void close();  // closes the connection, closed callback is called once the first time
+
+    // sends a frame already encoded in the subscriber's format
+    void send_frame(Frame_Ptr payload);
+
+    bool is_streaming() const;
+    camsrv::camsrv_message::camsrv_format get_format() const;
+    Encode_Target get_target() const;  // format and maximum size the client asked for
+    std::uint32_t get_stream_id() const;
+    std::uint32_t get_id() const;
+
+private:
+    void reset_buffers();    // resets buffer stream for received data
+    void start_keepalive();  // starts keep-alive timer
+    void start_read();
+    camsrv::camsrv_message image_header(const Frame &frame) const;
+    void send_reply(camsrv::camsrv_message header, Frame_Ptr payload);  // never skipped
+    void start_write(camsrv::camsrv_message header, Frame_Ptr payload);
+    void write_next();  // starts writing whatever is waiting on the write in flight
+
+    void update_stream_status(bool status);
+    bool select_stream(std::uint32_t requested_stream_id);
+    bool update_format(const camsrv::camsrv_message &request);
+
+    std::unique_ptr<boost::asio::ip::tcp::socket> socket;
+    boost::asio::steady_timer timer;  // keep-alive timer
+    boost::asio::streambuf message_buffer;
+    std::size_t message_size = camsrv::LEGACY_MESSAGE_SIZE;  // grows once the client says hello
+
+    // writing frames, only one write is ever in flight and only the latest frame waits behind it
+    camsrv::camsrv_message write_header;  // header of the frame currently being written
+    bool writing = false;
+    std::int64_t write_started_ns = 0;
+    Frame_Ptr pending_frame;  // latest frame waiting on the write in flight
+    std::uint64_t frames_skipped = 0;  // frames replaced by a newer one before they could be sent
+    std::deque<std::pair<camsrv::camsrv_message, Frame_Ptr>> pending_replies;
+    // compressed video can't skip to the latest frame, those queue up behind the write in flight
+    Video_Queue video_frames;
+
+    const std::uint32_t id;      // only used to tell subscribers apart
+    // shared memory ring each stream's frames are published to, empty if there is none
+    const std::vector<std::string> shm_names;
+    bool closed = false;
+    bool streaming = false;
+    std::uint32_t stream_id = 0;  // camera the client is following
+
+    // format the client asked for, clients that never ask get full size png
+    Encode_Target target;
+
+    std::shared_ptr<Pipeline_Stats> stats;  // shared with the server and every other subscriber
+
+    Status_Callback status_callback;
+    Closed_Callback closed_callback;
+    Stats_Callback stats_callback;
+};
+
+#endif
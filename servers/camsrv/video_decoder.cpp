@@ -0,0 +1,156 @@
+#include "video_decoder.hpp"
+
+// standard includes
+#include <cstring>
+#include <iostream>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+#include "defines.hpp"
+
+Video_Decoder::Video_Decoder(boost::asio::io_service &io_service, Frame::Format f,
+                             Decode_Callback cb, Histogram &ds)
+    : io_service(io_service),
+      format(f),
+      callback(cb),
+      decode_stats(ds),
+      frames(camsrv::VIDEO_QUEUE_SIZE) {
+#ifdef CAMSRV_USE_AVCODEC
+    if (open_codec()) worker = std::thread(std::bind(&Video_Decoder::worker_thread, this));
+#endif
+}
+
+Video_Decoder::~Video_Decoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    if (worker.joinable()) worker.join();
+
+#ifdef CAMSRV_USE_AVCODEC
+    sws_freeContext(scaler);
+    av_frame_free(&picture);
+    av_packet_free(&packet);
+    avcodec_free_context(&context);
+#endif
+}
+
+bool Video_Decoder::is_supported() {
+#ifdef CAMSRV_USE_AVCODEC
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Video_Decoder::decode(Frame_Ptr frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) return;  // couldn't open the codec, nothing will ever get decoded
+
+        frames.push(std::move(frame));
+    }
+    condition.notify_one();
+}
+
+std::uint64_t Video_Decoder::get_frames_dropped() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames.get_frames_dropped();
+}
+
+void Video_Decoder::worker_thread() {
+#ifdef CAMSRV_USE_AVCODEC
+    while (true) {
+        Frame_Ptr frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return stopping || !frames.empty(); });
+            if (stopping) return;
+
+            frame = frames.pop();
+        }
+
+        auto start = Histogram::now_ns();
+        auto decoded = decode_frame(*frame);
+        decode_stats.record_since(start);
+        frame.reset();  // the camera's receive buffer can go back to its pool right away
+
+        if (decoded) io_service.post(std::bind(callback, std::move(decoded)));
+    }
+#endif
+}
+
+#ifdef CAMSRV_USE_AVCODEC
+bool Video_Decoder::open_codec() {
+    auto codec_id = format == Frame::Format::H264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_HEVC;
+    auto codec = avcodec_find_decoder(codec_id);
+    if (!codec) {
+        std::cerr << "video decoder: libavcodec has no decoder for format "
+                  << static_cast<std::uint32_t>(format) << std::endl;
+        return false;
+    }
+
+    context = avcodec_alloc_context3(codec);
+    packet = av_packet_alloc();
+    picture = av_frame_alloc();
+    if (!context || !packet || !picture) {
+        std::cerr << "video decoder: couldn't allocate decoder" << std::endl;
+        return false;
+    }
+
+    // frames should come out as soon as they went in, frame threading would hold them back
+    context->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    context->thread_type = FF_THREAD_SLICE;
+    if (avcodec_open2(context, codec, nullptr) < 0) {
+        std::cerr << "video decoder: couldn't open decoder for format "
+                  << static_cast<std::uint32_t>(format) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+Frame_Ptr Video_Decoder::decode_frame(const Frame &frame) {
+    packet_data.resize(frame.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+    std::memcpy(packet_data.data(), frame.data(), frame.size());
+    std::memset(packet_data.data() + frame.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    packet->data = packet_data.data();
+    packet->size = static_cast<int>(frame.size());
+    if (avcodec_send_packet(context, packet) < 0) {
+        SLOG_ERROR("video decoder", "couldn't decode frame", slog::field("size", frame.size()));
+        return nullptr;
+    }
+
+    // one frame in is one picture out with low delay, only the latest is kept just in case
+    Frame_Ptr decoded;
+    while (avcodec_receive_frame(context, picture) == 0) decoded = convert_picture(frame.capture());
+    return decoded;
+}
+
+Frame_Ptr Video_Decoder::convert_picture(const Capture_Info &capture) {
+    scaler = sws_getCachedContext(scaler, picture->width, picture->height,
+                                  static_cast<AVPixelFormat>(picture->format), picture->width,
+                                  picture->height, AV_PIX_FMT_BGR24, SWS_BILINEAR, nullptr,
+                                  nullptr, nullptr);
+    if (!scaler) {
+        SLOG_ERROR("video decoder", "can't convert picture format",
+                   slog::field("format", picture->format));
+        return nullptr;
+    }
+
+    std::vector<std::uint8_t> bgr(static_cast<std::size_t>(picture->width) * picture->height * 3);
+    std::uint8_t *destination[] = {bgr.data()};
+    int destination_stride[] = {picture->width * 3};
+    sws_scale(scaler, picture->data, picture->linesize, 0, picture->height, destination,
+              destination_stride);
+
+    return std::make_shared<const Frame>(std::move(bgr), Frame::Format::BGR,
+                                         static_cast<std::uint16_t>(picture->width),
+                                         static_cast<std::uint16_t>(picture->height),
+                                         Frame::Type::KEY, capture);
+}
+#endif
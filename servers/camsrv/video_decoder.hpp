@@ -0,0 +1,78 @@
+#ifndef video_decoder__HPP
+#define video_decoder__HPP
+
+// standard includes
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// boost includes
+#include <boost/asio.hpp>
+
+#ifdef CAMSRV_USE_AVCODEC
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+#include "frame.hpp"
+#include "stats.hpp"
+#include "video_queue.hpp"
+
+// Decodes a camera's h.264 or h.265 frames into bgr frames for clients that can't take compressed
+// video. Video frames depend on the ones before them, so unlike the encoder pool every frame of a
+// stream goes through the same decoder, in order, on a thread of its own. When decoding falls
+// behind, frames are dropped the way a video queue drops them. Only available when built with
+// libavcodec.
+class Video_Decoder {
+public:
+    // called on the io service with every decoded frame, the time every frame took to decode is
+    // recorded into decode stats, which has to outlive us
+    using Decode_Callback = std::function<void(Frame_Ptr)>;
+    Video_Decoder(boost::asio::io_service &io_service, Frame::Format format,
+                  Decode_Callback callback, Histogram &decode_stats);
+    ~Video_Decoder();
+
+    Video_Decoder(const Video_Decoder &) = delete;
+    Video_Decoder &operator=(const Video_Decoder &) = delete;
+
+    static bool is_supported();  // whether we were built with a decoder at all
+
+    void decode(Frame_Ptr frame);
+
+    std::uint64_t get_frames_dropped() const;
+
+private:
+    void worker_thread();
+
+#ifdef CAMSRV_USE_AVCODEC
+    bool open_codec();
+    Frame_Ptr decode_frame(const Frame &frame);              // nullptr if no picture came out
+    Frame_Ptr convert_picture(const Capture_Info &capture);  // into bgr
+
+    AVCodecContext *context = nullptr;
+    AVPacket *packet = nullptr;
+    AVFrame *picture = nullptr;
+    SwsContext *scaler = nullptr;  // only recreated when the picture size or format changes
+    std::vector<std::uint8_t> packet_data;  // libavcodec wants padding after the frame's bytes
+#endif
+
+    boost::asio::io_service &io_service;  // service our results get posted back to
+    const Frame::Format format;
+    Decode_Callback callback;
+    Histogram &decode_stats;
+
+    // pending frames, guarded by mutex
+    Video_Queue frames;
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+
+    std::thread worker;
+};
+
+#endif
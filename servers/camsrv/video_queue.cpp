@@ -0,0 +1,47 @@
+#include "video_queue.hpp"
+
+Video_Queue::Video_Queue(std::size_t mf) : maximum_frames(mf) {}
+
+void Video_Queue::push(Frame_Ptr frame) {
+    if (frame->type() == Frame::Type::KEY)
+        waiting_for_key_frame = false;
+    else if (waiting_for_key_frame) {
+        frames_dropped++;
+        return;
+    }
+
+    // nothing depends on a disposable frame, so it's the first to go once we're falling behind
+    if (frame->type() == Frame::Type::DISPOSABLE && !frames.empty()) {
+        frames_dropped++;
+        return;
+    }
+
+    if (frames.size() >= maximum_frames) {
+        frames_dropped += frames.size();
+        frames.clear();
+        if (frame->type() != Frame::Type::KEY) {
+            frames_dropped++;
+            waiting_for_key_frame = true;
+            return;
+        }
+    }
+
+    frames.push_back(std::move(frame));
+}
+
+Frame_Ptr Video_Queue::pop() {
+    if (frames.empty()) return nullptr;
+
+    auto frame = std::move(frames.front());
+    frames.pop_front();
+    return frame;
+}
+
+bool Video_Queue::empty() const { return frames.empty(); }
+
+void Video_Queue::restart() {
+    frames.clear();
+    waiting_for_key_frame = true;
+}
+
+std::uint64_t Video_Queue::get_frames_dropped() const { return frames_dropped; }
@@ -0,0 +1,34 @@
+#ifndef video_queue__HPP
+#define video_queue__HPP
+
+// standard includes
+#include <cstdint>
+#include <deque>
+
+#include "frame.hpp"
+
+// Compressed video frames waiting on a client or a decoder. Unlike other frames these can't just
+// be replaced by the newest one, every frame after a key frame needs the ones before it. Once the
+// queue backs up, disposable frames are the first to go. If it fills up anyway, everything gets
+// dropped and the queue waits for the next key frame. Not thread safe.
+class Video_Queue {
+public:
+    explicit Video_Queue(std::size_t maximum_frames);
+
+    void push(Frame_Ptr frame);
+    Frame_Ptr pop();  // nullptr when empty
+    bool empty() const;
+
+    void restart();  // drops everything, frames are taken again from the next key frame on
+
+    std::uint64_t get_frames_dropped() const;
+
+private:
+    std::deque<Frame_Ptr> frames;
+    const std::size_t maximum_frames;
+    bool waiting_for_key_frame = true;  // a decoder can't make any sense of anything else
+
+    std::uint64_t frames_dropped = 0;
+};
+
+#endif
@@ -8,15 +8,43 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <set>
 
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+#include "frame.hpp"
 #include "server.hpp"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
+#define FRAME_STALL_TIMEOUT_SECONDS 2
+
+namespace {
+// pixel formats we know how to handle, in order of preference when none was asked for
+struct supported_format {
+    std::string name;
+    std::uint32_t pixel_format;
+    Frame::Format frame_format;
+};
+
+const std::array<supported_format, 3> SUPPORTED_FORMATS = {{
+    {"mjpeg", V4L2_PIX_FMT_MJPEG, Frame::Format::JPEG},
+    {"yuyv", V4L2_PIX_FMT_YUYV, Frame::Format::YUYV},
+    {"nv12", V4L2_PIX_FMT_NV12, Frame::Format::NV12},
+}};
+}  // namespace
 
 WebCamera::WebCamera(std::shared_ptr<Server> svr, boost::asio::io_service &controller_service,
-                     boost::asio::io_service &io_service, std::string dn)
-    : Camera(svr, controller_service, io_service, dn), timer(io_service) {
+                     boost::asio::io_service &io_service, std::string dn,
+                     camsrv::capture_options_type capture_options, std::uint32_t stream_id)
+    : Camera(svr, controller_service, io_service, dn, stream_id),
+      descriptor(io_service),
+      stall_timer(io_service) {
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// Opening Device
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -32,12 +60,15 @@ WebCamera::WebCamera(std::shared_ptr<Server> svr, boost::asio::io_service &contr
         std::exit(EXIT_FAILURE);
     }
 
-    file_descriptor = open(Camera::get_device_name().c_str(), O_RDWR);
+    // non-blocking so dequeuing a buffer that isn't ready yet returns instead of stalling us
+    file_descriptor = open(Camera::get_device_name().c_str(), O_RDWR | O_NONBLOCK);
     if (file_descriptor == -1) {
         std::cout << "could not open " << Camera::get_device_name() << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
+    descriptor.assign(file_descriptor);  // lets the camera service wait on the device for frames
+
     std::cout << Camera::get_device_name() << " opened successfully" << std::endl;
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -64,82 +95,67 @@ WebCamera::WebCamera(std::shared_ptr<Server> svr, boost::asio::io_service &contr
         std::exit(EXIT_FAILURE);
     }
 
-    // getting formats of the device
-    struct v4l2_fmtdesc fd;
-    CLEAR(fd);
-    bool mjpeg_found = false;
-    fd.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    while (xioctl(VIDIOC_ENUM_FMT, &fd) == 0) {
-        std::cout << "found format: " << reinterpret_cast<char *>(&fd.description) << std::endl;
-        if (fd.pixelformat == V4L2_PIX_FMT_MJPEG) {
-            mjpeg_found = true;
-            break;
-        }
-        fd.index++;
-    }
-
-    if (!mjpeg_found) {
-        std::cout << Camera::get_device_name() << " does not appear to be a mjpeg device"
-                  << std::endl;
-        std::exit(EXIT_FAILURE);
-    }
+    // negotiating pixel format and resolution, the driver may still adjust what we ask for
+    auto pixel_format = choose_pixel_format(capture_options.pixel_format);
+    auto width = capture_options.width;
+    auto height = capture_options.height;
+    choose_frame_size(pixel_format, width, height);
 
     // setting format of device
     CLEAR(fmt);
     fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = 320;
-    fmt.fmt.pix.height = 240;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
+    fmt.fmt.pix.width = width;
+    fmt.fmt.pix.height = height;
+    fmt.fmt.pix.pixelformat = pixel_format;
     fmt.fmt.pix.field = V4L2_FIELD_NONE;
 
     if (xioctl(VIDIOC_S_FMT, &fmt) == -1) {
         std::cout << "error: could not set format" << std::endl;
         std::exit(EXIT_FAILURE);
+    } else if (fmt.fmt.pix.pixelformat != pixel_format) {
+        std::cout << "error: " << Camera::get_device_name() << " refused pixel format"
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
     }
 
-    // getting supported framerates
-    struct v4l2_frmivalenum frmivalenum;
-    CLEAR(frmivalenum);
-    frmivalenum.height = 240;
-    frmivalenum.width = 320;
-    std::uint32_t fps_denominator = 30;
-    frmivalenum.pixel_format = V4L2_PIX_FMT_MJPEG;
+    frame_width = static_cast<std::uint16_t>(fmt.fmt.pix.width);
+    frame_height = static_cast<std::uint16_t>(fmt.fmt.pix.height);
 
-    while (xioctl(VIDIOC_ENUM_FRAMEINTERVALS, &frmivalenum) == 0) {
-        if (frmivalenum.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
-            auto fps = 1.0 * frmivalenum.discrete.denominator / frmivalenum.discrete.numerator;
-            if (frmivalenum.discrete.numerator != 1) {
-                std::cout << "unsupported numerator in framerate" << std::endl;
-                std::exit(EXIT_FAILURE);
-            } else if ((fps < fps_denominator) && fps >= 15) {
-                fps_denominator = static_cast<std::uint32_t>(fps);
-            }
-        }
-        frmivalenum.index++;
+    // uncompressed frames get converted straight out of device memory, which assumes there is no
+    // padding at the end of each row
+    auto bytes_per_pixel = (frame_format == Frame::Format::YUYV) ? 2 : 1;
+    if (frame_format != Frame::Format::JPEG &&
+        fmt.fmt.pix.bytesperline != fmt.fmt.pix.width * bytes_per_pixel) {
+        std::cout << "error: " << Camera::get_device_name() << " pads rows to "
+                  << fmt.fmt.pix.bytesperline << " bytes, which is not supported" << std::endl;
+        std::exit(EXIT_FAILURE);
     }
 
-    std::cout << "found lowest supported framerate " << fps_denominator << std::endl;
+    std::cout << "capturing " << frame_width << "x" << frame_height << std::endl;
 
     // setting framerate
     CLEAR(sp);
     sp.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     sp.parm.capture.capturemode |= V4L2_CAP_TIMEPERFRAME;
-    sp.parm.capture.timeperframe.numerator = 1;
-    sp.parm.capture.timeperframe.denominator = fps_denominator;
+    sp.parm.capture.timeperframe =
+        choose_frame_interval(pixel_format, fmt.fmt.pix.width, fmt.fmt.pix.height,
+                              capture_options.fps);
     if (xioctl(VIDIOC_S_PARM, &sp) == -1) {
         std::cout << "error setting video stream params" << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
-    std::cout << "framerate set to " << fps_denominator << std::endl;
+    auto &tpf = sp.parm.capture.timeperframe;  // driver hands back what it actually uses
+    if (tpf.numerator)
+        std::cout << "framerate set to " << 1.0 * tpf.denominator / tpf.numerator << std::endl;
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// Initializing Memory Map
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    // request the buffers
+    // request the buffers, the driver is free to hand us back a different count than we asked for
     struct v4l2_requestbuffers rb;
     CLEAR(rb);
-    rb.count = 1;
+    rb.count = capture_options.buffer_count;
     rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     rb.memory = V4L2_MEMORY_MMAP;
 
@@ -147,49 +163,170 @@ WebCamera::WebCamera(std::shared_ptr<Server> svr, boost::asio::io_service &contr
         std::cout << "error: " << Camera::get_device_name() << " does not support memory mapping"
                   << std::endl;
         std::exit(EXIT_FAILURE);
-        int joe;
+    } else if (rb.count < 2) {
+        std::cout << "error: insufficient buffer memory on " << Camera::get_device_name()
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
     }
 
-    // set and create the buffer
-    struct v4l2_buffer buf;
-    CLEAR(buf);
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = 0;
+    std::cout << "allocated " << rb.count << " capture buffers (requested "
+              << capture_options.buffer_count << ")" << std::endl;
+
+    // set and create each of the buffers in our ring
+    buffers.resize(rb.count);
+    for (std::uint32_t i = 0; i < rb.count; i++) {
+        struct v4l2_buffer buf;
+        CLEAR(buf);
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (xioctl(VIDIOC_QUERYBUF, &buf) == -1) {
+            std::cout << "error: could not query buffer " << i << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
 
-    if (xioctl(VIDIOC_QUERYBUF, &buf) == -1) {
-        std::cout << "error: could not query buffers" << std::endl;
-        std::exit(EXIT_FAILURE);
-    }
+        auto res = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor,
+                        buf.m.offset);
 
-    buffer_size = buf.length;
-    auto res =
-        mmap(NULL, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, buf.m.offset);
+        if (res == MAP_FAILED) {
+            std::cout << "error: mapping buffer " << i << " failed" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
 
-    if (res == MAP_FAILED) {
-        std::cout << "error: mapping failed" << std::endl;
-        std::exit(EXIT_FAILURE);
+        auto mapping = std::make_shared<buffer_mapping>();
+        mapping->start = static_cast<std::uint8_t *>(res);
+        mapping->length = buf.length;
+        buffers.at(i).mapping = std::move(mapping);
     }
+}
 
-    buffer = static_cast<std::uint8_t *>(res);
+WebCamera::buffer_mapping::~buffer_mapping() {
+    // the driver only frees a buffer once it's unmapped, closing the device doesn't
+    if (start && munmap(start, length) == -1)
+        SLOG_ERROR("wc", "failed to unmap capture buffer", slog::field("error", strerror(errno)));
 }
 
 WebCamera::~WebCamera() {
-    // uninitializing device
+    // uninitializing device, buffers still held by frames stay mapped until those frames are gone
     std::cout << "uninitializing device" << std::endl;
-    if (munmap(buffer, buffer_size) == -1) {
-        std::cout << "error: munmap" << std::endl;
-        std::exit(EXIT_FAILURE);
-    }
+    buffers.clear();
 
-    // closing device
+    // closing device, we still own the file descriptor so the descriptor object must not close it
     std::cout << "closing " << Camera::get_device_name() << std::endl;
+    descriptor.release();
     if (::close(file_descriptor) == -1) {
         std::cout << "error closing " << Camera::get_device_name() << std::endl;
         std::exit(EXIT_FAILURE);
     }
 }
 
+std::uint32_t WebCamera::choose_pixel_format(const std::string &requested) {
+    // getting formats of the device
+    std::set<std::uint32_t> device_formats;
+    struct v4l2_fmtdesc fd;
+    CLEAR(fd);
+    fd.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    while (xioctl(VIDIOC_ENUM_FMT, &fd) == 0) {
+        std::cout << "found format: " << reinterpret_cast<char *>(&fd.description) << std::endl;
+        device_formats.insert(fd.pixelformat);
+        fd.index++;
+    }
+
+    for (const auto &f : SUPPORTED_FORMATS) {
+        if (!requested.empty() && requested != f.name) continue;
+
+        if (device_formats.count(f.pixel_format)) {
+            std::cout << "using pixel format " << f.name << std::endl;
+            frame_format = f.frame_format;
+            return f.pixel_format;
+        }
+    }
+
+    if (requested.empty())
+        std::cout << Camera::get_device_name() << " does not support mjpeg, yuyv or nv12"
+                  << std::endl;
+    else
+        std::cout << Camera::get_device_name() << " does not support " << requested << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+void WebCamera::choose_frame_size(std::uint32_t pixel_format, std::uint32_t &width,
+                                  std::uint32_t &height) {
+    struct v4l2_frmsizeenum frmsizeenum;
+    CLEAR(frmsizeenum);
+    frmsizeenum.pixel_format = pixel_format;
+
+    // discrete sizes get listed one by one, pick the one closest in area to what was asked for
+    auto requested_area = static_cast<long long>(width) * height;
+    long long best_difference = -1;
+    std::uint32_t best_width = width, best_height = height;
+    while (xioctl(VIDIOC_ENUM_FRAMESIZES, &frmsizeenum) == 0) {
+        if (frmsizeenum.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+            auto &d = frmsizeenum.discrete;
+            auto area = static_cast<long long>(d.width) * d.height;
+            auto difference = std::llabs(area - requested_area);
+            if (best_difference < 0 || difference < best_difference) {
+                best_difference = difference;
+                best_width = d.width;
+                best_height = d.height;
+            }
+        } else {
+            // stepwise and continuous devices only report a single range
+            auto &sw = frmsizeenum.stepwise;
+            auto fit = [](std::uint32_t value, std::uint32_t min, std::uint32_t max,
+                          std::uint32_t step) {
+                value = std::min(std::max(value, min), max);
+                return step ? min + (value - min) / step * step : value;
+            };
+            best_width = fit(width, sw.min_width, sw.max_width, sw.step_width);
+            best_height = fit(height, sw.min_height, sw.max_height, sw.step_height);
+            break;
+        }
+        frmsizeenum.index++;
+    }
+
+    // devices that can't enumerate sizes are left to adjust the request themselves
+    width = best_width;
+    height = best_height;
+}
+
+struct v4l2_fract WebCamera::choose_frame_interval(std::uint32_t pixel_format,
+                                                   std::uint32_t width, std::uint32_t height,
+                                                   std::uint32_t fps) {
+    struct v4l2_frmivalenum frmivalenum;
+    CLEAR(frmivalenum);
+    frmivalenum.pixel_format = pixel_format;
+    frmivalenum.width = width;
+    frmivalenum.height = height;
+
+    struct v4l2_fract best = {1, fps};
+    double best_difference = -1;
+    while (xioctl(VIDIOC_ENUM_FRAMEINTERVALS, &frmivalenum) == 0) {
+        if (frmivalenum.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+            // intervals are listed as fractions of a second, pick the closest framerate
+            auto &d = frmivalenum.discrete;
+            auto difference = d.numerator ? std::fabs(1.0 * d.denominator / d.numerator - fps) : 0;
+            if (d.numerator && (best_difference < 0 || difference < best_difference)) {
+                best_difference = difference;
+                best = d;
+            }
+        } else {
+            // stepwise and continuous devices only report a single range of intervals
+            auto &sw = frmivalenum.stepwise;
+            auto interval = 1.0 / fps;
+            if (sw.min.denominator && interval < 1.0 * sw.min.numerator / sw.min.denominator)
+                best = sw.min;
+            else if (sw.max.denominator && interval > 1.0 * sw.max.numerator / sw.max.denominator)
+                best = sw.max;
+            break;
+        }
+        frmivalenum.index++;
+    }
+
+    return best;
+}
+
 int WebCamera::xioctl(unsigned long request, void *arg) {
     int res;
 
@@ -200,43 +337,131 @@ int WebCamera::xioctl(unsigned long request, void *arg) {
     return res;
 }
 
-void WebCamera::read_frame() {
-    timer.async_wait([&](boost::system::error_code error) {
-        if (Camera::is_streaming() && !error) {
-            struct v4l2_buffer buf;
-            CLEAR(buf);
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
-            buf.index = 0;
-
-            if (xioctl(VIDIOC_QBUF, &buf) == -1) {
-                std::cout << "query error" << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
+void WebCamera::queue_buffer(std::uint32_t index) {
+    struct v4l2_buffer buf;
+    CLEAR(buf);
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
 
-            fd_set fs;
-            FD_ZERO(&fs);
-            FD_SET(file_descriptor, &fs);
-            struct timeval tv;
-            CLEAR(tv);
-            tv.tv_sec = 2;
-            int r = select(file_descriptor + 1, &fs, NULL, NULL, &tv);
-            if (r == -1) {
-                std::cout << "error: waiting on frame" << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
+    if (xioctl(VIDIOC_QBUF, &buf) == -1) {
+        std::cout << "query error" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
 
-            if (xioctl(VIDIOC_DQBUF, &buf) == -1) {
-                std::cout << "error: retrieving frame" << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
+void WebCamera::queue_all_buffers() {
+    // buffers still referenced by a frame get queued once that frame is released
+    for (std::uint32_t i = 0; i < buffers.size(); i++) {
+        if (!buffers.at(i).held) queue_buffer(i);
+    }
+}
+
+void WebCamera::release_buffer(std::uint32_t index) {
+    buffers.at(index).held = false;
+
+    // if the stream was turned off in the meantime, turning it on will queue the buffer again
+    if (Camera::is_streaming()) queue_buffer(index);
+}
+
+void WebCamera::track_sequence(std::uint32_t sequence) {
+    frames_received++;
 
-            std::vector<std::uint8_t> sf;
-            sf.resize(static_cast<int>(buf.bytesused));
-            memcpy(sf.data(), buffer, buf.bytesused);
-            controller_service.post(std::bind(&Server::send_frame, server, sf));
+    // any gap in the driver's sequence numbers means it had no free buffer to fill
+    if (sequence_started && sequence > last_sequence + 1) {
+        auto dropped = sequence - last_sequence - 1;
+        frames_dropped += dropped;
+        SLOG_WARNING("wc", "driver dropped frames", slog::field("dropped", dropped),
+                     slog::field("frames_dropped", frames_dropped),
+                     slog::field("frames_total", frames_received + frames_dropped));
+    }
 
-            read_frame();  // recursively read webcam data (but in event loop)
+    sequence_started = true;
+    last_sequence = sequence;
+}
+
+bool WebCamera::dequeue_frame() {
+    // every buffer in the ring stays queued, so take whichever one the driver finished
+    struct v4l2_buffer buf;
+    CLEAR(buf);
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(VIDIOC_DQBUF, &buf) == -1) {
+        if (errno == EAGAIN) return false;  // no frame ready yet
+
+        std::cout << "error: retrieving frame" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto &mb = buffers.at(buf.index);
+    mb.sequence = buf.sequence;
+    mb.timestamp = buf.timestamp;
+    track_sequence(buf.sequence);
+
+    // drivers stamp frames with the monotonic clock when capture started, the odd one that doesn't
+    // gets stamped now, which is as close as we can get
+    auto sequence = frames_received + frames_dropped;  // carries on across stream restarts
+    Capture_Info capture;
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+        capture = Capture_Info::from_monotonic(
+            sequence, static_cast<std::int64_t>(buf.timestamp.tv_sec) * 1000000000 +
+                          static_cast<std::int64_t>(buf.timestamp.tv_usec) * 1000);
+    else
+        capture = Capture_Info::now(sequence);
+
+    // handing the driver's memory straight to the server, the buffer goes back to the driver once
+    // the server drops its last reference to the frame. The frame keeps the buffer mapped, and only
+    // hands it back if the camera is still around by then.
+    mb.held = true;
+    auto index = buf.index;
+    auto mapping = mb.mapping;
+    std::weak_ptr<WebCamera> camera = shared_from_this();
+    auto frame = std::make_shared<const Frame>(
+        mapping->start, buf.bytesused,
+        [camera, mapping, index]() {
+            if (auto c = camera.lock())
+                c->io_service.post([camera, index]() {
+                    if (auto c = camera.lock()) c->release_buffer(index);
+                });
+        },
+        frame_format, frame_width, frame_height, Frame::Type::KEY, capture);
+    controller_service.post(
+        std::bind(&Server::send_frame, server, Camera::get_stream_id(), std::move(frame)));
+
+    return true;
+}
+
+void WebCamera::read_frame() {
+    // the reactor only tells us about new frames, so pick up any that arrived before we got here
+    while (Camera::is_streaming() && dequeue_frame()) start_stall_timer();
+
+    if (!Camera::is_streaming()) return;
+
+    // sleep until the kernel tells us the device has a frame ready for us
+    descriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                          [&](const boost::system::error_code &error) {
+                              if (error == boost::asio::error::operation_aborted) return;
+
+                              if (error)
+                                  SLOG_ERROR("wc", "error waiting on frame",
+                                             slog::field("error", error.message()));
+                              else
+                                  read_frame();  // recursively read webcam data (in event loop)
+                          });
+}
+
+void WebCamera::start_stall_timer() {
+    // restarting the timer cancels the previous wait, so this only fires if frames stop arriving
+    stall_timer.expires_after(std::chrono::seconds(FRAME_STALL_TIMEOUT_SECONDS));
+    stall_timer.async_wait([&](const boost::system::error_code &error) {
+        if (!error && Camera::is_streaming()) {
+            stalls++;
+            SLOG_WARNING("wc", "no frame received, camera may be hung",
+                         slog::field("camera", Camera::get_device_name()),
+                         slog::field("timeout_seconds", FRAME_STALL_TIMEOUT_SECONDS),
+                         slog::field("stalls", stalls));
+            start_stall_timer();  // keep reporting for as long as the camera stays quiet
         }
     });
 }
@@ -251,22 +476,32 @@ void WebCamera::send_stream_request(unsigned long request) {
 }
 
 void WebCamera::set_stream(bool on) {
+    if (on == Camera::is_streaming()) return;  // nothing to change, buffers are already set
+
     if (on) {
-        std::cout << "wc: starting webcamera stream" << std::endl;
+        SLOG_INFO("wc", "starting webcamera stream",
+                  slog::field("camera", Camera::get_device_name()));
 
+        // turning the stream off hands every buffer back to us, so they all need queuing again
+        queue_all_buffers();
+        sequence_started = false;
         send_stream_request(VIDIOC_STREAMON);
 
         Camera::set_stream(true);  // start streaming to server
+        start_stall_timer();       // start watching for the camera going quiet
         read_frame();              // start trying to read frames from device
     } else {
-        std::cout << "wc: stopping webcamera stream" << std::endl;
+        SLOG_INFO("wc", "stopping webcamera stream",
+                  slog::field("camera", Camera::get_device_name()));
 
         send_stream_request(VIDIOC_STREAMOFF);
 
         // resetting stream parameters
         Camera::set_stream(false);  // stop streaming to server
-        timer.cancel();             // stop trying to read frames from device
+        descriptor.cancel();        // stop trying to read frames from device
+        stall_timer.cancel();       // stop watching for the camera going quiet
 
-        std::cout << "wc: camera stream stopped" << std::endl;
+        SLOG_INFO("wc", "camera stream stopped", slog::field("frames_received", frames_received),
+                  slog::field("frames_dropped", frames_dropped));
     }
 }
\ No newline at end of file
@@ -2,34 +2,87 @@
 #define webcamera__HPP
 
 // standard includes
+#include <memory>
 #include <string>
+#include <vector>
+
+// c includes
+#include <linux/videodev2.h>
+#include <sys/time.h>
 
 // boost includes
 #include <boost/asio.hpp>
 
 #include "camera.hpp"
+#include "defines.hpp"
+#include "frame.hpp"
 
 class Server;  // forward declaration
 
-class WebCamera : public Camera {
+class WebCamera : public Camera, public std::enable_shared_from_this<WebCamera> {
 public:
     WebCamera(std::shared_ptr<Server> server, boost::asio::io_service &controller_service,
-              boost::asio::io_service &io_service, std::string device_name);
+              boost::asio::io_service &io_service, std::string device_name,
+              camsrv::capture_options_type capture_options, std::uint32_t stream_id);
     ~WebCamera();
 
     void set_stream(bool on);  // lets you turn stream on/off
 
 private:
+    // negotiating what to capture, each picks whatever the device supports closest to the request
+    std::uint32_t choose_pixel_format(const std::string &requested);
+    void choose_frame_size(std::uint32_t pixel_format, std::uint32_t &width,
+                           std::uint32_t &height);
+    struct v4l2_fract choose_frame_interval(std::uint32_t pixel_format, std::uint32_t width,
+                                            std::uint32_t height, std::uint32_t fps);
+
     void read_frame();
+    bool dequeue_frame();      // returns false when the driver has no frame ready for us
+    void start_stall_timer();  // reports a hung camera if no frame arrives in time
+    void queue_buffer(std::uint32_t index);    // hands a buffer back to the driver
+    void release_buffer(std::uint32_t index);  // called once the last frame reference is dropped
+    void queue_all_buffers();                // hands every buffer in the ring to the driver
+    void track_sequence(std::uint32_t sequence);
     void send_stream_request(unsigned long request);
     int xioctl(unsigned long request, void *arg);  // utility helper
 
-    // buffer
-    std::uint8_t *buffer;
-    size_t buffer_size;
+    // a driver buffer's memory, unmapped once neither the camera nor any frame pointing into it is
+    // left, so frames can outlive the camera
+    struct buffer_mapping {
+        std::uint8_t *start = nullptr;
+        size_t length = 0;
+        ~buffer_mapping();
+    };
+
+    // a single memory mapped driver buffer within our capture ring
+    struct mapped_buffer {
+        std::shared_ptr<buffer_mapping> mapping;
+
+        // details of the last frame the driver filled this buffer with
+        std::uint32_t sequence = 0;
+        struct timeval timestamp = {};
+
+        bool held = false;  // a frame referencing this buffer is still being sent
+    };
+
+    // buffers
+    std::vector<mapped_buffer> buffers;
+
+    // what the device ended up capturing, every frame gets tagged with it
+    Frame::Format frame_format = Frame::Format::JPEG;
+    std::uint16_t frame_width = 0;
+    std::uint16_t frame_height = 0;
+
+    // frame accounting, sequence numbers restart every time the stream is turned on
+    bool sequence_started = false;
+    std::uint32_t last_sequence = 0;
+    std::uint64_t frames_received = 0;
+    std::uint64_t frames_dropped = 0;  // frames the driver had to throw away
+    std::uint64_t stalls = 0;          // times the camera went quiet while streaming
 
     int file_descriptor;
-    boost::asio::steady_timer timer;
+    boost::asio::posix::stream_descriptor descriptor;  // used to wait on the device for frames
+    boost::asio::steady_timer stall_timer;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,112 @@
+#include "capture_replay.hpp"
+
+// standard includes
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// c includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+namespace {
+void capture_failure(const std::string &path, const char *what) {
+    std::cerr << "capture replay: failed to " << what << " " << path << ", error: "
+              << std::strerror(errno) << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+}  // namespace
+
+Capture_Replay::Capture_Replay(const std::vector<std::string> &paths, std::size_t chunk_size) {
+    if (paths.empty() || chunk_size == 0) {
+        std::cerr << "capture replay: needs at least one file and a chunk size" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    for (const auto &path : paths) {
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) capture_failure(path, "open");
+
+        struct stat st;
+        if (fstat(fd, &st) < 0) capture_failure(path, "stat");
+        if (st.st_size == 0) {
+            std::cerr << "capture replay: " << path << " is empty" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        // the mapping stays valid after the file is closed
+        auto size = static_cast<std::size_t>(st.st_size);
+        auto address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) capture_failure(path, "map");
+        madvise(address, size, MADV_SEQUENTIAL);
+        mappings.push_back({address, size});
+
+        SLOG_INFO("replay", "mapped capture file", slog::field("path", path),
+                  slog::field("bytes", size));
+    }
+
+    // the slots can't move once handed out, so they're all made before anything is
+    std::size_t count = 0;
+    for (const auto &m : mappings) count += (m.size + chunk_size - 1) / chunk_size;
+    chunks = std::vector<Scan_Slot>(count);
+
+    auto chunk = chunks.begin();
+    for (const auto &m : mappings) {
+        auto data = static_cast<std::uint8_t *>(m.address);
+        for (std::size_t offset = 0; offset < m.size; offset += chunk_size, chunk++) {
+            // handed out as writable like any other scan buffer, nothing writes scan data though
+            chunk->data = data + offset;
+            chunk->size = chunk->capacity = std::min(chunk_size, m.size - offset);
+            chunk->references = 0;
+            chunk->owner = this;
+            chunk->sequence = 0;
+            chunk->timestamp_ns = 0;
+            chunk->settings_hash = 0;
+        }
+    }
+}
+
+Capture_Replay::~Capture_Replay() {
+    for (const auto &m : mappings) munmap(m.address, m.size);
+}
+
+Scan_Buffer Capture_Replay::next() {
+    auto &chunk = chunks[next_chunk];
+    next_chunk = (next_chunk + 1) % chunks.size();
+
+    // nothing but us hands a chunk out, once it's free nothing else can take it
+    if (chunk.references.load(std::memory_order_acquire) != 0) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return Scan_Buffer();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (outstanding++ == 0) keep_alive = shared_from_this();
+    }
+    chunk.references.store(1, std::memory_order_relaxed);
+    return Scan_Buffer(&chunk);
+}
+
+void Capture_Replay::release(Scan_Slot *) {
+    // may be the last thing keeping us around, it has to go after the lock does
+    std::shared_ptr<Capture_Replay> last;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--outstanding == 0) last = std::move(keep_alive);
+    }
+}
+
+std::size_t Capture_Replay::get_chunk_count() const { return chunks.size(); }
+
+std::uint64_t Capture_Replay::get_skipped_count() const {
+    return skipped.load(std::memory_order_relaxed);
+}
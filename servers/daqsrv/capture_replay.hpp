@@ -0,0 +1,53 @@
+#ifndef CAPTURE_REPLAY_HPP
+#define CAPTURE_REPLAY_HPP
+
+// standard includes
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// internal includes
+#include "scan_buffer_pool.hpp"
+
+// Replays raw scan data captured off a daq, for test mode. Every file is mapped into memory and cut
+// into chunks of the size a read would have been (the last chunk of a file can be shorter), chunks
+// are handed out in order, going back to the first file after the last one. Chunks are handed out
+// as scan buffers pointing straight into the mapping, nothing gets copied or parsed. A chunk can't
+// be handed out again while it's still held, the same way a pool buffer can't.
+class Capture_Replay : public Scan_Slot_Owner,
+                       public std::enable_shared_from_this<Capture_Replay> {
+public:
+    Capture_Replay(const std::vector<std::string> &paths, std::size_t chunk_size);
+    ~Capture_Replay();
+
+    Capture_Replay(const Capture_Replay &) = delete;
+    Capture_Replay &operator=(const Capture_Replay &) = delete;
+
+    // the next chunk, or an empty buffer if that chunk is still held from the last time around
+    // (it's skipped either way)
+    Scan_Buffer next();
+
+    std::size_t get_chunk_count() const;
+    std::uint64_t get_skipped_count() const;  // chunks that were still held
+
+private:
+    void release(Scan_Slot *slot) override;
+
+    struct mapping {
+        void *address;
+        std::size_t size;
+    };
+    std::vector<mapping> mappings;
+
+    std::vector<Scan_Slot> chunks;
+    std::size_t next_chunk = 0;
+    std::size_t outstanding = 0;                 // guarded by mutex, chunks handed out
+    std::shared_ptr<Capture_Replay> keep_alive;  // guarded by mutex, set while any are out
+    std::atomic<std::uint64_t> skipped{0};
+    std::mutex mutex;
+};
+
+#endif
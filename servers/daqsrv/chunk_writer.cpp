@@ -0,0 +1,207 @@
+#include "chunk_writer.hpp"
+
+// standard includes
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+// c includes
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+namespace {
+// Talks to the kernel's io_uring directly through its system calls, the rings are shared memory
+// the kernel reads submissions from and writes completions to. Only the one thread ever uses it.
+class Uring_Writer : public Chunk_Writer {
+public:
+    ~Uring_Writer() override {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring) munmap(sq_ring, sq_ring_size);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    // false if the kernel doesn't have io_uring, or won't let us use it (seccomp, containers)
+    bool setup(unsigned int depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (ring_fd < 0) return false;
+
+        // plain writes only came along with this feature (linux 5.6)
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            errno = ENOSYS;
+            return false;
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+        sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+        if (!sq_ring) return false;
+        cq_ring = single_mmap ? sq_ring : map(cq_ring_size, IORING_OFF_CQ_RING);
+        if (!cq_ring) return false;
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(map(sqes_size, IORING_OFF_SQES));
+        if (!sqes) return false;
+
+        auto sq = static_cast<std::uint8_t *>(sq_ring);
+        sq_head = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+
+        auto cq = static_cast<std::uint8_t *>(cq_ring);
+        cq_head = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool submit(int fd, const void *data, std::size_t size, std::uint64_t offset,
+                std::uint64_t tag) override {
+        if (dead) return false;
+
+        // the caller never has more in flight than the ring has room for, so there's always a
+        // free entry
+        auto tail = *sq_tail;
+        auto index = tail & sq_mask;
+        auto &sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(data);
+        sqe.len = static_cast<std::uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sq_array[index] = index;
+
+        // the kernel has to see the entry before it sees the tail move past it
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        long result;
+        do {
+            result = syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+        if (result >= 1) return true;
+
+        // an entry the kernel took off the ring completes whatever enter returned
+        auto error = result < 0 ? errno : EAGAIN;
+        if (__atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == tail + 1) return true;
+
+        // it only takes entries while we're in io_uring_enter, so it never saw this one. It has to
+        // come off the ring before the caller gives up on the write, or a later enter would still
+        // write it and hand back a completion for a tag that's been reused. Not worth trying
+        // again, nothing after a failed write can be indexed anyway.
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+        dead = true;
+        SLOG_ERROR("writer", "failed to submit write", slog::field("error", strerror(error)));
+        return false;
+    }
+
+    bool wait(Completion &completion) override {
+        while (true) {
+            auto head = *cq_head;
+            if (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+                const auto &cqe = cqes[head & cq_mask];
+                completion.tag = cqe.user_data;
+                completion.result = cqe.res;
+                __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+
+            auto result =
+                syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result < 0 && errno != EINTR) {
+                SLOG_ERROR("writer", "failed waiting on writes",
+                           slog::field("error", strerror(errno)));
+                return false;
+            }
+        }
+    }
+
+    const char *name() const override { return "io_uring"; }
+
+private:
+    void *map(std::size_t size, std::uint64_t offset) {
+        auto address =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    int ring_fd = -1;
+    void *sq_ring = nullptr;
+    void *cq_ring = nullptr;
+    std::size_t sq_ring_size = 0;
+    std::size_t cq_ring_size = 0;
+    io_uring_sqe *sqes = nullptr;
+    std::size_t sqes_size = 0;
+
+    bool dead = false;  // a write couldn't be submitted, so nothing more is
+
+    unsigned int *sq_head = nullptr;
+    unsigned int *sq_tail = nullptr;
+    unsigned int sq_mask = 0;
+    unsigned int *sq_array = nullptr;
+    unsigned int *cq_head = nullptr;
+    unsigned int *cq_tail = nullptr;
+    unsigned int cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+};
+
+// Writes as soon as a write is submitted, waiting only hands back what already happened.
+class Pwrite_Writer : public Chunk_Writer {
+public:
+    explicit Pwrite_Writer(unsigned int depth) : completions(depth) {}
+
+    bool submit(int fd, const void *data, std::size_t size, std::uint64_t offset,
+                std::uint64_t tag) override {
+        auto bytes = static_cast<const std::uint8_t *>(data);
+        std::int64_t written = 0;
+        while (written < static_cast<std::int64_t>(size)) {
+            auto result = pwrite(fd, bytes + written, size - written, offset + written);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) {
+                written = result < 0 ? -errno : written;
+                break;
+            }
+            written += result;
+        }
+
+        completions[(first + count++) % completions.size()] = {tag, written};
+        return true;
+    }
+
+    bool wait(Completion &completion) override {
+        if (count == 0) return false;  // nothing was submitted
+        completion = completions[first];
+        first = (first + 1) % completions.size();
+        count--;
+        return true;
+    }
+
+    const char *name() const override { return "pwrite"; }
+
+private:
+    std::vector<Completion> completions;  // a ring of the ones not yet waited on
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
+}  // namespace
+
+std::unique_ptr<Chunk_Writer> Chunk_Writer::create(unsigned int depth) {
+    auto uring = std::make_unique<Uring_Writer>();
+    if (uring->setup(depth)) return uring;
+
+    SLOG_WARNING("writer", "io_uring isn't available, falling back on pwrite",
+                 slog::field("error", strerror(errno)));
+    return std::make_unique<Pwrite_Writer>(depth);
+}
@@ -0,0 +1,31 @@
+#ifndef CHUNK_WRITER_HPP
+#define CHUNK_WRITER_HPP
+
+// standard includes
+#include <cstdint>
+#include <memory>
+
+// Writes chunks of a file without waiting for them to be written, completions are waited on
+// separately. Data has to stay around until its write has completed. Writes to a file opened with
+// O_DIRECT need their data, size and offset aligned to the file system's block size.
+class Chunk_Writer {
+public:
+    struct Completion {
+        std::uint64_t tag;    // what the write was submitted with
+        std::int64_t result;  // bytes written, or a negative errno
+    };
+
+    virtual ~Chunk_Writer() = default;
+
+    virtual bool submit(int fd, const void *data, std::size_t size, std::uint64_t offset,
+                        std::uint64_t tag) = 0;
+    virtual bool wait(Completion &completion) = 0;  // blocks until a write completes
+
+    virtual const char *name() const = 0;
+
+    // an io_uring writer if the kernel lets us have one, otherwise one that writes as it's
+    // submitted. Never more than depth writes are in flight at once.
+    static std::unique_ptr<Chunk_Writer> create(unsigned int depth);
+};
+
+#endif
@@ -4,9 +4,11 @@
 #include <math.h>
 
 // standard includes
-#include <fstream>
+#include <algorithm>
 #include <iostream>
-#include <iterator>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
 
 // internal includes
 #include "defines.hpp"
@@ -14,6 +16,7 @@
 Controller::Controller(daqsrv::controller_options_type &controller_options,
                        boost::asio::io_service &io_service, Data_Callback callback)
     : test_mode(controller_options.test_mode),
+      test_files(controller_options.test_files),
       quickusb_timeout(controller_options.quickusb_timeout),
       daq_version(controller_options.daq_version),
       number_of_asics(controller_options.number_of_asics),
@@ -26,19 +29,15 @@ Controller::Controller(daqsrv::controller_options_type &controller_options,
       data_callback{callback} {
     serial_number = std::to_string(controller_options.serial_number).c_str()[0];
 
-    {
-        assert(test_data.str().length() == 0);  // sanity check
-        std::ifstream file("data.dat");
-        test_data << file.rdbuf();
-        verify_truth(test_data.str().length() > 0, __PRETTY_FUNCTION__, "failed to open data.dat");
-    }
-
     quickusb = std::make_shared<squsb::squsb>();
     std::cout << "controller: using sis_quick_usb version number: "
               << quickusb->get_version_number() << std::endl;
+
+    create_scan_buffers();
 }
 
 Controller::~Controller() {
+    abort_reads();
     std::cout << "controller: disconnecting from QuickUsb" << std::endl;
     quickusb->disconnect_from_qusb();
 }
@@ -49,15 +48,25 @@ void Controller::connect_to_daq() {
 }
 
 void Controller::setup_daq() {
+    if (test_mode) {
+        // there's no daq to set up, scan data comes from the capture files
+        SLOG_INFO("controller", "test mode, replaying capture files",
+                  slog::field("chunks", capture_replay->get_chunk_count()));
+        connected = true;
+        replay_deadline = std::chrono::steady_clock::now();
+        start_scanning();
+        return;
+    }
+
     set_default_quickusb_settings();
 
     switch (daq_version) {
         case DAQ_VERSIONS::VERSION_1:
-            std::cout << "controller: using daq version 1" << std::endl;
+            SLOG_INFO("controller", "using daq version 1");
             initialize_daq_version_1();
             break;
         case DAQ_VERSIONS::VERSION_2:
-            std::cout << "controller: using daq version 2" << std::endl;
+            SLOG_INFO("controller", "using daq version 2");
             initialize_daq_version_2();
             break;
         default:
@@ -67,12 +76,12 @@ void Controller::setup_daq() {
 
     connected = true;
 
-    std::cout << "controller: starting to scan" << std::endl;
+    SLOG_INFO("controller", "starting to scan");
     start_scanning();
 }
 
 void Controller::set_default_quickusb_settings() {
-    std::cout << "controller: setting default quickusb settings" << std::endl;
+    SLOG_INFO("controller", "setting default quickusb settings");
 
     // setting settings for first address
     const auto ADR_1 = 1;
@@ -142,7 +151,8 @@ void Controller::initialize_daq_version_2() {
     t = quickusb->read_fpga(ASICS_NUMBER_ADDRESS);
     verify_truth(std::get<0>(t), __PRETTY_FUNCTION__, "failed read fpga: asics");
     verify_truth(std::get<1>(t), __PRETTY_FUNCTION__, "failed to set the number of asics value");
-    std::cout << "squsb: successful setting the number of asics" << std::get<1>(t) << std::endl;
+    SLOG_INFO("controller", "successful setting the number of asics",
+              slog::field("asics", std::get<1>(t)));
 
     // setting msbuff value
     // MSBUFF (address = 0 or 0x09) = upper 7 bits of ADDCNT or Buffer Address for the memory, Lower
@@ -173,7 +183,7 @@ void Controller::initialize_daq_version_2() {
     verify_truth(std::get<0>(t), __PRETTY_FUNCTION__, "failed to read fpga: pareg");
     verify_truth(std::get<1>(t) == pareg, __PRETTY_FUNCTION__,
                  "failed to set msbuff " + std::to_string(pareg));
-    std::cout << "controller: successful set pareg " << static_cast<int>(pareg) << std::endl;
+    SLOG_INFO("controller", "successful set pareg", slog::field("pareg", pareg));
 
     // setting config value
     // CONFIG[7:0] (address = 11 or 0x0b)
@@ -189,8 +199,7 @@ void Controller::initialize_daq_version_2() {
     verify_truth(std::get<0>(t), __PRETTY_FUNCTION__, "failed to read fpga: config");
     verify_truth(std::get<1>(t) == config_val, __PRETTY_FUNCTION__,
                  "failed to set config " + std::to_string(config_val));
-    std::cout << "controller: successful set config value " << static_cast<int>(config_val)
-              << std::endl;
+    SLOG_INFO("controller", "successful set config value", slog::field("config", config_val));
 
     // setting start reset address
     // STRT_RST (address 15 or 0x0f)
@@ -208,30 +217,153 @@ void Controller::initialize_daq_version_2() {
 
 void Controller::start_scanning() {
     if (connected) {
-        std::uint8_t buff[buffer_size * read_multiple];
-        QULONG l = sizeof(buff);
-        auto res = quickusb->read_data(&buff[0], &l);
-
         if (!test_mode) {
-            if (res) {
-                data_callback(std::move(
-                    std::vector<std::uint8_t>(buff, buff + (sizeof(buff) / sizeof(buff[0])))));
-                start_scan_timer(0);  // immediately post (the read will take a second or so)
-                return;
-            } else
-                std::cout
-                    << "controller: failed to successfully read quickusb data, adding delay of 1s"
-                    << std::endl;
+            // topping up reads in flight, then waiting on the oldest and starting the next one
+            // before handing its data off, so the board always has a read to fill
+            while (pending_read_count < pending_reads.size() && start_read())
+                ;
+
+            if (pending_read_count > 0) {
+                auto &read = pending_reads[first_pending_read];
+                first_pending_read = (first_pending_read + 1) % pending_reads.size();
+                pending_read_count--;
+
+                QULONG byte_count = 0;
+                auto buffer = std::move(read.buffer);  // frees up its place in the ring
+                if (quickusb->wait_for_read(read.transaction, &byte_count)) {
+                    buffer.set_size(std::min<std::size_t>(byte_count, read.length));
+                    start_read();  // the next read goes out before this one is handed off
+                    hand_off(std::move(buffer));
+
+                    if (++reads_completed % daqsrv::SCAN_BUFFER_STATS_INTERVAL_READS == 0)
+                        log_scan_buffer_stats();
+                    start_scan_timer(0);  // immediately post (the read will take a second or so)
+                    return;
+                }
+
+                abort_reads();  // the board is in a bad way, starting over after the delay
+            }
+
+            SLOG_WARNING("controller", "failed to read quickusb data, adding delay of 1s");
         } else {
-            data_callback(
-                std::vector<std::uint8_t>((std::istream_iterator<std::uint8_t>(test_data)),
-                                          std::istream_iterator<std::uint8_t>()));
+            replay_scan();
+            return;
         }
 
         // if we make it this far this fast, we want to hold off a bit for realism
         start_scan_timer(1);
     } else
-        std::cerr << "controller: start scanning requested but daq is not connected?" << std::endl;
+        SLOG_ERROR("controller", "start scanning requested but daq is not connected?");
+}
+
+void Controller::create_scan_buffers() {
+    // buffers still held by the server keep the old pool around until they come back
+    std::size_t read_size = std::max(buffer_size * read_multiple, 1u);
+    settings_hash = hash_settings();
+    if (test_mode) {
+        capture_replay = std::make_shared<Capture_Replay>(test_files, read_size);
+        return;
+    }
+
+    auto count =
+        std::min(daqsrv::SCAN_BUFFER_COUNT, daqsrv::MAXIMUM_SCAN_BUFFER_MEMORY / read_size);
+    count = std::max(count, daqsrv::QUICKUSB_READS_IN_FLIGHT + 1);
+    scan_buffers = std::make_shared<Scan_Buffer_Pool>(read_size, count);
+    SLOG_INFO("controller", "created scan buffers", slog::field("count", count),
+              slog::field("size", scan_buffers->get_buffer_size()));
+}
+
+bool Controller::start_read() {
+    auto buffer = scan_buffers->acquire();
+    if (!buffer) {
+        // the server is still holding every buffer, it'll drop data before we run out again
+        SLOG_WARNING("controller", "out of scan buffers",
+                     slog::field("times", scan_buffers->get_exhausted_count()));
+        return false;
+    }
+
+    auto &read = pending_reads[(first_pending_read + pending_read_count) % pending_reads.size()];
+    read.length = static_cast<QULONG>(buffer_size) * read_multiple;
+    if (!quickusb->read_data_async(buffer.data(), &read.length, &read.transaction)) return false;
+
+    read.buffer = std::move(buffer);
+    pending_read_count++;
+    return true;
+}
+
+void Controller::abort_reads() {
+    // reads can't be taken back once started, the board is still writing into their buffers
+    for (; pending_read_count > 0; pending_read_count--) {
+        auto &read = pending_reads[first_pending_read];
+        QULONG byte_count = 0;
+        quickusb->wait_for_read(read.transaction, &byte_count);
+        read.buffer = Scan_Buffer();
+        first_pending_read = (first_pending_read + 1) % pending_reads.size();
+    }
+}
+
+void Controller::log_scan_buffer_stats() {
+    // slab allocations only go up with settings changes, anything else would mean reads allocate
+    SLOG_INFO("controller", "scan buffer stats", slog::field("reads", reads_completed),
+              slog::field("acquired", scan_buffers->get_acquired_count()),
+              slog::field("exhausted", scan_buffers->get_exhausted_count()),
+              slog::field("slab_allocations", Scan_Buffer_Pool::get_slab_allocation_count()));
+}
+
+void Controller::hand_off(Scan_Buffer buffer) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    buffer.stamp(scan_sequence++,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), settings_hash);
+    data_callback(std::move(buffer));
+}
+
+std::uint32_t Controller::hash_settings() const {
+    // fnv-1a over everything that changes what the scan data means, recordings keep it per scan
+    std::uint32_t hash = 2166136261u;
+    auto add = [&](std::uint32_t value) {
+        for (int i = 0; i < 4; i++, value >>= 8) hash = (hash ^ (value & 0xff)) * 16777619u;
+    };
+    add(buffer_size);
+    add(read_multiple);
+    add(static_cast<unsigned char>(ms_buff));
+    add(static_cast<unsigned char>(number_of_asics));
+    add(sample_time);
+    add(quickusb_timeout);
+    add(daq_version);
+    return hash;
+}
+
+void Controller::replay_scan() {
+    // a chunk the server still holds is skipped, the same as data the server can't keep up with
+    std::size_t size = static_cast<std::size_t>(buffer_size) * read_multiple;
+    if (auto buffer = capture_replay->next()) {
+        size = buffer.size();
+        hand_off(std::move(buffer));
+    }
+
+    // paced off deadlines rather than delays so the time spent handing data off doesn't add up,
+    // unless we fell so far behind that catching up would mean a burst
+    auto now = std::chrono::steady_clock::now();
+    if (now - replay_deadline > std::chrono::seconds(1)) {
+        SLOG_WARNING("controller", "replay fell behind, skipping ahead",
+                     slog::field("skipped_chunks", capture_replay->get_skipped_count()));
+        replay_deadline = now;
+    }
+    replay_deadline += scan_duration(size);
+
+    timer.expires_at(replay_deadline);
+    timer.async_wait([&](const boost::system::error_code &error) {
+        if (!error) start_scanning();
+    });
+}
+
+std::chrono::nanoseconds Controller::scan_duration(std::size_t bytes) const {
+    // every sample is the same number of bytes for every asic, taken every sample time
+    std::uint64_t sample_bytes =
+        static_cast<unsigned char>(number_of_asics) * daqsrv::ASIC_SAMPLE_BYTES;
+    if (sample_bytes == 0) sample_bytes = daqsrv::ASIC_SAMPLE_BYTES;
+    return std::chrono::nanoseconds(static_cast<std::uint64_t>(bytes) * sample_time * 1000000 /
+                                    sample_bytes);
 }
 
 void Controller::start_scan_timer(unsigned int seconds) {
@@ -308,6 +440,7 @@ unsigned char Controller::three_bits(unsigned long from, int first_bit) {
 
 void Controller::update_settings(daqsrv::daq_settings_type daq_settings) {
     timer.cancel();  // cancelling timer
+    abort_reads();   // were started with the old settings
 
     buffer_size = daq_settings.buffer_size;
     ms_buff = daq_settings.ms_buff;
@@ -316,13 +449,13 @@ void Controller::update_settings(daqsrv::daq_settings_type daq_settings) {
     read_multiple = daq_settings.read_multiple;
     sample_time = daq_settings.timing;
 
-    std::cout << "controller: received settings update" << std::endl;
-    std::cout << "controller: buffer_size: " << buffer_size
-              << ", ms_buff: " << static_cast<int>(ms_buff)
-              << ", number_of_asics: " << static_cast<int>(number_of_asics)
-              << ", qusb_timeout: " << quickusb_timeout << ", read_multiple: " << read_multiple
-              << ", sample_time: " << sample_time << std::endl;
+    SLOG_INFO("controller", "received settings update", slog::field("buffer_size", buffer_size),
+              slog::field("ms_buff", static_cast<int>(ms_buff)),
+              slog::field("number_of_asics", static_cast<int>(number_of_asics)),
+              slog::field("qusb_timeout", quickusb_timeout),
+              slog::field("read_multiple", read_multiple), slog::field("sample_time", sample_time));
 
+    create_scan_buffers();
     setup_daq();
     start_scan_timer(0);  // start scan timer immediately after settings update
 }
\ No newline at end of file
@@ -8,15 +8,18 @@
 #include <sis_quick_usb/sis_quick_usb.hpp>
 
 // standard includes
+#include <array>
 #include <memory>
 
 // internal includes
+#include "capture_replay.hpp"
 #include "daq_message_type.hpp"
 #include "defines.hpp"
+#include "scan_buffer_pool.hpp"
 
 class Controller {
 public:
-    using Data_Callback = std::function<void(std::vector<std::uint8_t>)>;
+    using Data_Callback = std::function<void(Scan_Buffer)>;
     Controller(daqsrv::controller_options_type &controller_options,
                boost::asio::io_service &io_service, Data_Callback callback);
     ~Controller();
@@ -35,6 +38,20 @@ private:
     void start_scanning();
     void start_scan_timer(unsigned int seconds);
 
+    // reads are kept in flight back to back so the usb link never sits idle between them
+    void create_scan_buffers();  // for the current buffer size and read multiple
+    bool start_read();
+    void abort_reads();  // waits out every read still in flight, throwing away what they read
+    void log_scan_buffer_stats();
+
+    // stamps scan data with where it came from before it's handed off
+    void hand_off(Scan_Buffer buffer);
+    std::uint32_t hash_settings() const;
+
+    // test mode, capture files get replayed at the rate the daq would have read them at
+    void replay_scan();
+    std::chrono::nanoseconds scan_duration(std::size_t bytes) const;  // for the daq to fill
+
     // utility functions
     char get_pareg(unsigned int sample_time);
     void verify_truth(bool truth, std::string function_name, std::string error);
@@ -77,6 +94,9 @@ private:
     // test mode
     bool test_mode = false;
     bool test_server = false;
+    std::vector<std::string> test_files;  // captures replayed in test mode
+    std::shared_ptr<Capture_Replay> capture_replay;
+    std::chrono::steady_clock::time_point replay_deadline;  // when the next chunk is due
 
     // fpga addresses
     const QWORD ASICS_NUMBER_ADDRESS = 0x8;
@@ -109,7 +129,21 @@ private:
     boost::asio::io_service &io_service;
     boost::asio::steady_timer timer;
 
-    std::stringstream test_data;
+    // a read started on the quickusb board and not yet waited on
+    struct pending_read {
+        Scan_Buffer buffer;
+        QULONG length;  // has to stay put until the read is waited on
+        QBYTE transaction;
+    };
+    std::shared_ptr<Scan_Buffer_Pool> scan_buffers;
+
+    // reads in the order they finish in, a ring so keeping them going never allocates
+    std::array<pending_read, daqsrv::QUICKUSB_READS_IN_FLIGHT> pending_reads;
+    std::size_t first_pending_read = 0;
+    std::size_t pending_read_count = 0;
+    std::uint64_t reads_completed = 0;
+    std::uint64_t scan_sequence = 0;  // scans handed off, including any dropped along the way
+    std::uint32_t settings_hash = 0;  // of the settings the scan buffers were made for
 
     Data_Callback data_callback;
 };
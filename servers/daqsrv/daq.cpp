@@ -3,31 +3,36 @@
 DAQ::DAQ(std::uint16_t port, daqsrv::controller_options_type &controller_options,
          boost::asio::io_service &io_service)
     : io_service(io_service) {
+    if (!controller_options.record_directory.empty())
+        recorder = std::make_unique<Recorder>(
+            controller_options.record_directory,
+            static_cast<std::uint64_t>(controller_options.record_segment_mb) * 1024 * 1024);
+
+    // the controller only lives on its own thread, settings are handed over with the update. Any
+    // that come in before the controller is up wait in its service until it is.
     server = std::make_shared<Server>(io_service, port, [&](daqsrv::daq_settings_type daq_stgs) {
-        daq_settings = daq_stgs;
-        daq_settings_updated = true;
-        if (controller)
-            controller_service.post(
-                std::bind(&Controller::update_settings, std::ref(controller), daq_settings));
+        controller_service.post([this, daq_stgs]() { controller->update_settings(daq_stgs); });
     });
     controller_thread = std::thread(std::bind(&DAQ::worker_thread, this, controller_options));
 }
 
 DAQ::~DAQ() {
-    controller_thread.join();
+    // the controller's thread only returns once its service is stopped
     controller_service.stop();
+    controller_thread.join();
+    controller.reset();
+    recorder.reset();  // once nothing more can be recorded, writing out what's left
 }
 
 void DAQ::worker_thread(daqsrv::controller_options_type &controller_options) {
+    // scan data goes straight to the server and the recorder, which queue it for their own
+    // threads to write out
     controller = std::make_unique<Controller>(controller_options, controller_service,
-                                              [&](std::vector<std::uint8_t> data) {
-
+                                              [&](Scan_Buffer data) {
+                                                  if (recorder) recorder->record(data.share());
+                                                  server->send_scan_data(std::move(data));
                                               });
 
-    io_service.post([&]() {
-        if (daq_settings_updated) controller->update_settings(daq_settings);
-    });
-
     // This stops the thread from exiting just because we don't have any tasks that currently
     // need completing
     boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard(
@@ -12,6 +12,7 @@
 #include "controller.hpp"
 #include "daq_message_type.hpp"
 #include "defines.hpp"
+#include "recorder.hpp"
 #include "server.hpp"
 
 class DAQ {
@@ -30,13 +31,7 @@ private:
     // objects
     std::shared_ptr<Controller> controller;  // quickusb controller
     std::shared_ptr<Server> server;          // tcp server
-
-    // daq settings
-    daqsrv::daq_settings_type daq_settings;  // keeping track of settings
-    // just keeping track if we ever update so if we ever have a situation where the server object
-    // were to be created and connected and sent a settings update before we create our controller
-    // object in a different thread, we'd know to update
-    bool daq_settings_updated = false;
+    std::unique_ptr<Recorder> recorder;      // only there if scan data is being recorded
 
     std::thread controller_thread;  // thread for our quickusb controller
 };
@@ -2,8 +2,11 @@
 #define DAQSRV_DEFINES_HPP
 
 #include <array>
+#include <cstdint>
 #include <list>
 #include <map>
+#include <string>
+#include <vector>
 
 namespace daqsrv {
 const std::string DAQSRV_APPLICATION_NAME = "daqsrv";  // name of application
@@ -15,6 +18,35 @@ const std::string DAQSRV_APPLICATION_DESCRIPTION =
 const std::uint16_t MINIMUM_PORT_NUMBER = 1;
 const std::uint16_t MAXIMUM_PORT_NUMBER = 65535;
 
+// scan data buffers waiting to be written to the client before any get dropped
+const std::size_t SCAN_DATA_QUEUE_CAPACITY = 32;
+const unsigned int SCAN_DATA_STATS_INTERVAL_SECONDS = 10;  // how often throughput is logged
+
+// quickusb reads kept in flight at once, the next one is already running while one is handed off
+const std::size_t QUICKUSB_READS_IN_FLIGHT = 3;
+// scan data buffers waiting to be recorded before any get dropped, the recorder copies them out
+// into RECORDER_CHUNK_COUNT chunks of RECORDER_CHUNK_SIZE bytes that are written to disk in turn
+const std::size_t RECORDER_QUEUE_CAPACITY = 16;
+const std::size_t RECORDER_CHUNK_SIZE = 4 * 1024 * 1024;
+const std::size_t RECORDER_CHUNK_COUNT = 8;
+const std::size_t RECORDER_ALIGNMENT = 4096;  // O_DIRECT writes are a whole number of these
+// chunks written before the data file is synced and their scans indexed, a crash loses up to this
+// many chunks of scan data
+const std::size_t RECORDER_SYNC_CHUNKS = 8;
+const std::uint32_t MINIMUM_RECORD_SEGMENT_MB = 16;
+const std::uint32_t MAXIMUM_RECORD_SEGMENT_MB = 1024 * 1024;
+
+// enough scan buffers for every read in flight, full queues and the ones being written, unless
+// that would take more memory than this
+const std::size_t SCAN_BUFFER_COUNT =
+    SCAN_DATA_QUEUE_CAPACITY + RECORDER_QUEUE_CAPACITY + QUICKUSB_READS_IN_FLIGHT + 2;
+const std::size_t MAXIMUM_SCAN_BUFFER_MEMORY = 256 * 1024 * 1024;
+const std::uint64_t SCAN_BUFFER_STATS_INTERVAL_READS = 1000;  // how often buffer use is logged
+
+// bytes every asic adds to scan data per sample, 64 channels of 32 bit words, used to replay
+// captures at the rate the daq would have read them at
+const std::size_t ASIC_SAMPLE_BYTES = 64 * 4;
+
 const std::list<std::uint16_t> VALID_SAMPLE_TIMES = {4, 8, 16, 32, 64};
 const std::map<std::uint16_t, char> SAMPLE_TIME_MAP = {
     {4, 0b0000}, {8, 0b001}, {16, 0b010}, {32, 0b011}, {64, 0b100}};
@@ -31,6 +63,9 @@ struct controller_options_type {
     std::uint32_t buffer_size = 122880;     // size of buffer to read data off quickusb board
     std::uint16_t read_multiple = 1;        // read multiples of buffer size
     std::uint32_t quickusb_timeout = 1000;  // timeout for quickusb requests
+    std::vector<std::string> test_files = {"data.dat"};  // raw captures replayed in test mode
+    std::string record_directory;            // scan data is only recorded if this is set
+    std::uint32_t record_segment_mb = 1024;  // megabytes of scan data per recorded segment
 };
 }  // namespace daqsrv
 
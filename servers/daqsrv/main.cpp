@@ -17,7 +17,7 @@ const std::string OPTIONS_DESCRIPTION = "Options";  // options label for help me
 
 // creating an options table for user experience
 const int OPTIONS_NUMBER_PARAMETERS = 3;
-const int OPTIONS_NUMBER_ELEMENTS = 13;
+const int OPTIONS_NUMBER_ELEMENTS = 16;
 const std::array<const std::array<std::string, OPTIONS_NUMBER_PARAMETERS>, OPTIONS_NUMBER_ELEMENTS>
     OPTIONS_HANDLE = {{
         {"help", "h", "Displays this help."},
@@ -36,6 +36,9 @@ const std::array<const std::array<std::string, OPTIONS_NUMBER_PARAMETERS>, OPTIO
         {"read_multiple", "r", "Read multiples of buffer size to create less QuickUSB overhead."},
         {"test_server", "", "Test mode for server which sends off/on/raw data files."},
         {"timeout", "", "Timeout for QuickUSB requests."},
+        {"test_files", "", "Raw captures test mode replays instead of reading from FPGA."},
+        {"record_directory", "", "Directory every scan buffer is recorded to, none by default."},
+        {"record_segment_size", "", "Megabytes of scan data in each recorded segment."},
     }};
 
 enum OPTIONS {
@@ -52,6 +55,9 @@ enum OPTIONS {
     READ_MULTIPLE = 10,
     TEST_SERVER = 11,
     TIMEOUT = 12,
+    TEST_FILES = 13,
+    RECORD_DIRECTORY = 14,
+    RECORD_SEGMENT_SIZE = 15,
 };
 
 enum OPTION_HANDLES {
@@ -176,6 +182,18 @@ int main(int argc, char **argv) {
     auto to_opt = prog_opts::value<decltype(co.quickusb_timeout)>(&co.quickusb_timeout)
                       ->default_value(co.quickusb_timeout);
     auto to_desc = get_options_description(OPTIONS::TIMEOUT);
+    auto tf_hdl = get_option_handles(OPTIONS::TEST_FILES);
+    auto tf_opt = prog_opts::value<decltype(co.test_files)>(&co.test_files)
+                      ->multitoken()
+                      ->default_value(co.test_files, co.test_files.front());
+    auto tf_desc = get_options_description(OPTIONS::TEST_FILES);
+    auto rd_hdl = get_option_handles(OPTIONS::RECORD_DIRECTORY);
+    auto rd_opt = prog_opts::value<decltype(co.record_directory)>(&co.record_directory);
+    auto rd_desc = get_options_description(OPTIONS::RECORD_DIRECTORY);
+    auto rs_hdl = get_option_handles(OPTIONS::RECORD_SEGMENT_SIZE);
+    auto rs_opt = prog_opts::value<decltype(co.record_segment_mb)>(&co.record_segment_mb)
+                      ->default_value(co.record_segment_mb);
+    auto rs_desc = get_options_description(OPTIONS::RECORD_SEGMENT_SIZE);
 
     // creating our options table
     prog_opts::options_description desc(OPTIONS_DESCRIPTION);
@@ -215,6 +233,9 @@ int main(int argc, char **argv) {
                                                                                                                                                                   to_opt,
                                                                                                                                                                   to_desc
                                                                                                                                                                       .c_str());
+    desc.add_options()(tf_hdl.c_str(), tf_opt, tf_desc.c_str());
+    desc.add_options()(rd_hdl.c_str(), rd_opt, rd_desc.c_str())(rs_hdl.c_str(), rs_opt,
+                                                                rs_desc.c_str());
 
     // grabbing options from command line
     prog_opts::variables_map vars_map;
@@ -239,12 +260,16 @@ int main(int argc, char **argv) {
 
     // optional set values
     bool test_mode = vars_map.count(get_options_long_handle(OPTIONS::TEST_MODE));
+    co.test_mode = test_mode;
     bool test_server = vars_map.count(get_options_long_handle(OPTIONS::TEST_SERVER));
 
     // checking required minimums and maximums
     required_min_max_option_check<decltype(port_number)>(port_number, daqsrv::MINIMUM_PORT_NUMBER,
                                                          daqsrv::MAXIMUM_PORT_NUMBER,
                                                          get_options_long_handle(OPTIONS::PORT));
+    required_min_max_option_check<decltype(co.record_segment_mb)>(
+        co.record_segment_mb, daqsrv::MINIMUM_RECORD_SEGMENT_MB, daqsrv::MAXIMUM_RECORD_SEGMENT_MB,
+        get_options_long_handle(OPTIONS::RECORD_SEGMENT_SIZE));
 
     // getting required items that have multiple valid answers
     required_list_option_check<decltype(co.sample_time)>(
@@ -256,7 +281,17 @@ int main(int argc, char **argv) {
 
     auto daq = std::make_unique<DAQ>(port_number, co, io_service);
 
+    // being stopped is the only way we ever exit, the daq still has to be torn down properly so
+    // whatever's being recorded gets written out
+    boost::asio::signal_set signals(io_service, SIGINT, SIGTERM);
+    signals.async_wait([&](const boost::system::error_code &error, int signal_number) {
+        if (error) return;
+        std::cout << "daqsrv: stopping on signal " << signal_number << std::endl;
+        io_service.stop();
+    });
+
     io_service.run();
+    daq.reset();
 
     return 0;
 }
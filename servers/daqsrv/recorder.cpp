@@ -0,0 +1,309 @@
+#include "recorder.hpp"
+
+// standard includes
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// c includes
+#include <fcntl.h>
+#include <unistd.h>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+namespace {
+// O_DIRECT writes have to be a whole number of blocks
+std::size_t round_up_to_alignment(std::size_t size) {
+    return (size + daqsrv::RECORDER_ALIGNMENT - 1) / daqsrv::RECORDER_ALIGNMENT *
+           daqsrv::RECORDER_ALIGNMENT;
+}
+
+bool write_all(int fd, const void *data, std::size_t size) {
+    auto bytes = static_cast<const std::uint8_t *>(data);
+    while (size > 0) {
+        auto result = write(fd, bytes, size);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        bytes += result;
+        size -= result;
+    }
+    return true;
+}
+}  // namespace
+
+Recorder::Recorder(const std::string &directory, std::uint64_t segment_size)
+    : directory(directory),
+      segment_size(segment_size),
+      queue(daqsrv::RECORDER_QUEUE_CAPACITY),
+      writer(Chunk_Writer::create(daqsrv::RECORDER_CHUNK_COUNT)) {
+    memory = static_cast<std::uint8_t *>(std::aligned_alloc(
+        daqsrv::RECORDER_ALIGNMENT, daqsrv::RECORDER_CHUNK_SIZE * daqsrv::RECORDER_CHUNK_COUNT));
+    if (!memory) {
+        std::cerr << "recorder: failed to allocate " << daqsrv::RECORDER_CHUNK_COUNT
+                  << " chunks of " << daqsrv::RECORDER_CHUNK_SIZE << " bytes" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    for (std::size_t i = 0; i < chunks.size(); i++)
+        chunks[i].data = memory + i * daqsrv::RECORDER_CHUNK_SIZE;
+
+    auto now = std::chrono::system_clock::now();
+    started_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    auto seconds = std::chrono::system_clock::to_time_t(now);
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char name[32];
+    std::strftime(name, sizeof(name), "%Y%m%dT%H%M%SZ", &utc);
+    started = name;
+
+    // a directory we can't record to is a mistake in the options, better found out now
+    if (!open_segment()) {
+        std::cerr << "recorder: failed to start recording in " << directory << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    SLOG_INFO("recorder", "recording scan data", slog::field("directory", directory),
+              slog::field("writer", writer->name()), slog::field("segment_size", segment_size));
+    recorder_thread = std::thread(&Recorder::worker_thread, this);
+}
+
+Recorder::~Recorder() {
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+    recorder_thread.join();
+    std::free(memory);
+}
+
+void Recorder::record(Scan_Buffer data) {
+    if (failed.load(std::memory_order_relaxed)) return;
+
+    // the queue holds on to the buffer's reference until the recorder adopts it again, dropped
+    // data goes straight back to the controller's pool
+    auto slot = data.release();
+    if (!queue.push(slot)) {
+        Scan_Buffer::adopt(slot);
+        buffers_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (sleeping) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+}
+
+void Recorder::worker_thread() {
+    while (true) {
+        // nothing gets recorded once we're stopping, whatever was queued before still gets written
+        bool stop = stopping;
+        Scan_Slot *slot;
+        while (queue.pop(slot)) {
+            auto data = Scan_Buffer::adopt(slot);
+            if (!failed) write_scan(data);
+        }
+        if (stop) break;
+
+        // a wake up missed between popping and sleeping only costs the timeout
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping = true;
+        wake.wait_for(lock, std::chrono::milliseconds(10),
+                      [&]() { return queue.read_available() > 0 || stopping; });
+        sleeping = false;
+    }
+
+    close_segment();
+}
+
+void Recorder::write_scan(const Scan_Buffer &data) {
+    if (data.size() == 0) return;
+
+    // scans never straddle segments, a segment can only be bigger than its size for a scan that is
+    if (segment_bytes > 0 && segment_bytes + data.size() > segment_size) {
+        close_segment();
+        segment++;
+        if (!open_segment()) return;
+    }
+
+    daqsrv::recording_index_entry entry = {data.sequence(), data.timestamp_ns(), segment_bytes,
+                                           static_cast<std::uint32_t>(data.size()),
+                                           data.settings_hash()};
+
+    // the chunk being filled is never in flight, submitting one retires the next if it has to
+    std::size_t copied = 0;
+    while (copied < data.size()) {
+        auto &chunk = chunks[filling];
+        auto count = std::min(data.size() - copied, daqsrv::RECORDER_CHUNK_SIZE - chunk.size);
+        std::memcpy(chunk.data + chunk.size, data.data() + copied, count);
+        chunk.size += count;
+        copied += count;
+
+        // indexed once the chunk with its last byte is written, and so every chunk before it
+        if (copied == data.size()) chunk.entries.push_back(entry);
+        if (chunk.size == daqsrv::RECORDER_CHUNK_SIZE) submit_chunk();
+        if (failed) return;
+    }
+
+    segment_bytes += data.size();
+    buffers_recorded++;
+    bytes_recorded += data.size();
+}
+
+void Recorder::submit_chunk() {
+    // only the last chunk of a segment is ever short, padded out to what O_DIRECT can write and cut
+    // off again once the segment's closed
+    auto &chunk = chunks[filling];
+    auto size = round_up_to_alignment(chunk.size);
+    std::memset(chunk.data + chunk.size, 0, size - chunk.size);
+
+    chunk.in_flight = true;
+    chunk.completed = false;
+    in_flight++;
+    if (!writer->submit(data_fd, chunk.data, size, chunk.offset, filling)) {
+        chunk.completed = true;  // the writer won't take any more, this is as far as we get
+        chunk.result = -EIO;
+        fail("submitting scan data", EIO);
+    }
+
+    auto offset = chunk.offset + size;
+    filling = (filling + 1) % chunks.size();
+    if (chunks[filling].in_flight) retire_chunk();  // the ring's full, it has to be the oldest
+    chunks[filling].offset = offset;
+}
+
+void Recorder::retire_chunk() {
+    // writes can come back in any order, the index is only ever added to in the order they went out
+    auto &chunk = chunks[oldest];
+    while (!chunk.completed) {
+        Chunk_Writer::Completion completion;
+        if (!writer->wait(completion)) {
+            chunk.completed = true;
+            chunk.result = -EIO;
+            break;
+        }
+        chunks[completion.tag].completed = true;
+        chunks[completion.tag].result = completion.result;
+    }
+
+    if (chunk.result < 0)
+        fail("writing scan data", static_cast<int>(-chunk.result));
+    else if (static_cast<std::size_t>(chunk.result) != round_up_to_alignment(chunk.size))
+        fail("writing scan data", ENOSPC);  // a short write, the disk filled up
+
+    // syncing is a flush of the disk's cache, so it's only done every few chunks
+    if (!failed) {
+        unsynced_entries.insert(unsynced_entries.end(), chunk.entries.begin(),
+                                chunk.entries.end());
+        if (++unsynced_chunks >= daqsrv::RECORDER_SYNC_CHUNKS) sync_index();
+    }
+
+    chunk.entries.clear();
+    chunk.size = 0;
+    chunk.in_flight = false;
+    chunk.completed = false;
+    in_flight--;
+    oldest = (oldest + 1) % chunks.size();
+}
+
+void Recorder::sync_index() {
+    // the data has to be on disk before anything points at it, or a crash leaves an index pointing
+    // at data that never made it
+    if (!failed && !unsynced_entries.empty()) {
+        if (fdatasync(data_fd) < 0)
+            fail("syncing data file", errno);
+        else if (!write_all(index_fd, unsynced_entries.data(),
+                            unsynced_entries.size() * sizeof(daqsrv::recording_index_entry)))
+            fail("writing index", errno);
+    }
+
+    unsynced_entries.clear();
+    unsynced_chunks = 0;
+}
+
+bool Recorder::open_segment() {
+    std::ostringstream name;
+    name << directory << "/scan-" << started << "-" << std::setw(4) << std::setfill('0')
+         << segment;
+    auto data_path = name.str() + ".dat";
+    auto index_path = name.str() + ".idx";
+
+    // scan data goes straight to the disk, it's never read back and would only push everything
+    // else out of the page cache. Some file systems (tmpfs) can't do that, they get the page cache.
+    data_fd = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (data_fd < 0 && errno == EINVAL) {
+        SLOG_WARNING("recorder", "direct io isn't supported, writing through the page cache",
+                     slog::field("file", data_path));
+        data_fd = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (data_fd < 0) {
+        fail("opening data file", errno);
+        return false;
+    }
+
+    index_fd = open(index_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (index_fd < 0) {
+        fail("opening index file", errno);
+        return false;
+    }
+
+    daqsrv::recording_index_header header;
+    std::memcpy(header.magic, daqsrv::RECORDING_INDEX_MAGIC, sizeof(header.magic));
+    header.version = daqsrv::RECORDING_INDEX_VERSION;
+    header.entry_size = sizeof(daqsrv::recording_index_entry);
+    header.segment = segment;
+    header.started_ns = started_ns;
+    if (!write_all(index_fd, &header, sizeof(header))) {
+        fail("writing index", errno);
+        return false;
+    }
+
+    segment_bytes = 0;
+    chunks[filling].offset = 0;
+    SLOG_INFO("recorder", "opened segment", slog::field("segment", segment),
+              slog::field("file", data_path));
+    return true;
+}
+
+void Recorder::close_segment() {
+    if (!failed && chunks[filling].size > 0) submit_chunk();
+    while (in_flight > 0) retire_chunk();  // the chunks' memory is the kernel's until they are
+    chunks[filling].size = 0;              // anything left over after a failure
+    chunks[filling].entries.clear();
+
+    if (!failed) {
+        // the last chunk was padded out, the data file ends where the scan data does
+        if (ftruncate(data_fd, segment_bytes) < 0) fail("truncating data file", errno);
+        sync_index();  // the truncated data file is synced before the last of its entries go in
+        if (!failed && (fdatasync(data_fd) < 0 || fdatasync(index_fd) < 0))
+            fail("syncing segment", errno);
+    }
+    unsynced_entries.clear();  // anything left over after a failure
+    unsynced_chunks = 0;
+
+    if (data_fd >= 0) close(data_fd);
+    if (index_fd >= 0) close(index_fd);
+    data_fd = index_fd = -1;
+
+    SLOG_INFO("recorder", "closed segment", slog::field("segment", segment),
+              slog::field("bytes", segment_bytes),
+              slog::field("buffers_recorded", buffers_recorded),
+              slog::field("bytes_recorded", bytes_recorded),
+              slog::field("buffers_dropped", buffers_dropped.load(std::memory_order_relaxed)));
+}
+
+void Recorder::fail(const char *what, int error) {
+    // only the first failure is worth logging, everything after it follows from it
+    if (failed.exchange(true)) return;
+    SLOG_ERROR("recorder", "recording failed, scan data is still sent to clients",
+               slog::field("while", what), slog::field("error", strerror(error)),
+               slog::field("segment", segment));
+}
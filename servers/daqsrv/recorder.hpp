@@ -0,0 +1,101 @@
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+// boost includes
+#include <boost/lockfree/spsc_queue.hpp>
+
+// standard includes
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// internal includes
+#include "chunk_writer.hpp"
+#include "defines.hpp"
+#include "recording_format.hpp"
+#include "scan_buffer_pool.hpp"
+
+// Records every scan buffer to disk on its own thread, as segments of a data file and an index
+// (see recording_format.hpp). Scan data is copied into large aligned chunks which are written
+// without waiting on each other, so the disk sees big sequential writes no matter how small the
+// reads are. Nothing the recorder does ever holds up the controller, once it falls
+// RECORDER_QUEUE_CAPACITY buffers behind it drops them, and once a write fails it stops recording.
+class Recorder {
+public:
+    Recorder(const std::string &directory, std::uint64_t segment_size);
+    ~Recorder();
+
+    Recorder(const Recorder &) = delete;
+    Recorder &operator=(const Recorder &) = delete;
+
+    // called from the controller's thread (and only from it), never blocks
+    void record(Scan_Buffer data);
+
+private:
+    // a piece of the data file, filled with scan data and then written out as one
+    struct Chunk {
+        std::uint8_t *data;
+        std::size_t size = 0;    // bytes of scan data in it
+        std::uint64_t offset;    // in the segment's data file
+        bool in_flight = false;  // submitted and not yet retired
+        bool completed = false;  // its write came back, possibly out of order
+        std::int64_t result = 0;
+        std::vector<daqsrv::recording_index_entry> entries;  // scans that end in this chunk
+    };
+
+    void worker_thread();
+    void write_scan(const Scan_Buffer &data);
+    void submit_chunk();  // the one being filled, moving on to the next
+    void retire_chunk();  // waits for the oldest in flight, its scans are indexed once synced
+    void sync_index();    // syncs the data file, then indexes every scan that's now on disk
+    bool open_segment();
+    void close_segment();
+    void fail(const char *what, int error);
+
+    const std::string directory;
+    const std::uint64_t segment_size;  // bytes of scan data before moving on to the next segment
+    std::string started;               // when recording started, every segment's name has it
+    std::int64_t started_ns;
+
+    // buffers on their way from the controller's thread, released the same as the server's
+    boost::lockfree::spsc_queue<Scan_Slot *> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> failed{false};  // nothing more gets written once a write fails
+
+    // the chunks are in a ring, filled and written in turn
+    std::unique_ptr<Chunk_Writer> writer;
+    std::uint8_t *memory;  // every chunk's data, aligned for O_DIRECT
+    std::array<Chunk, daqsrv::RECORDER_CHUNK_COUNT> chunks;
+    std::size_t filling = 0;  // the chunk scan data is copied into
+    std::size_t oldest = 0;   // the chunk to retire next
+    std::size_t in_flight = 0;
+
+    // scans written out but not yet synced, their entries keep their capacity so once the first
+    // sync is through indexing never allocates
+    std::vector<daqsrv::recording_index_entry> unsynced_entries;
+    std::size_t unsynced_chunks = 0;
+
+    // the open segment
+    std::uint64_t segment = 0;
+    int data_fd = -1;
+    int index_fd = -1;
+    std::uint64_t segment_bytes = 0;  // of scan data, the data file is padded past it until closed
+
+    // counted since we started, logged as every segment is closed
+    std::atomic<std::uint64_t> buffers_dropped{0};  // the recorder wasn't keeping up
+    std::uint64_t buffers_recorded = 0;
+    std::uint64_t bytes_recorded = 0;
+
+    std::thread recorder_thread;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef RECORDING_FORMAT_HPP
+#define RECORDING_FORMAT_HPP
+
+#include <cstdint>
+
+// A recording is a series of segments, each a data file and an index file named
+// scan-<start time>-<segment number>.dat and .idx. The data file is every scan buffer's raw data
+// back to back, exactly as it was read off the daq. The index file is a header followed by an
+// entry for every scan buffer in the data file, in the order they were read. Entries are only
+// added once the data they point at has been written and synced to disk, so an index never points
+// past the end of its data file, even after a crash. What was recorded since the last sync has no
+// entries yet and is lost with it.
+namespace daqsrv {
+const char RECORDING_INDEX_MAGIC[8] = {'S', 'I', 'S', 'D', 'A', 'Q', 'I', 'X'};
+const std::uint32_t RECORDING_INDEX_VERSION = 1;
+
+struct recording_index_header {
+    char magic[8];             // RECORDING_INDEX_MAGIC
+    std::uint32_t version;     // RECORDING_INDEX_VERSION
+    std::uint32_t entry_size;  // sizeof(recording_index_entry) when it was written
+    std::uint64_t segment;     // number of the segment, starting at 0
+    std::int64_t started_ns;   // CLOCK_REALTIME the recording started at
+};
+
+struct recording_index_entry {
+    std::uint64_t sequence;       // the controller's count, gaps are scans that weren't recorded
+    std::int64_t timestamp_ns;    // CLOCK_REALTIME the scan was read at
+    std::uint64_t offset;         // of the scan's data in the segment's data file
+    std::uint32_t size;           // bytes of scan data
+    std::uint32_t settings_hash;  // changes whenever the daq settings do
+};
+}  // namespace daqsrv
+
+#endif
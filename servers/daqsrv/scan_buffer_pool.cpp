@@ -0,0 +1,131 @@
+#include "scan_buffer_pool.hpp"
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+
+// c includes
+#include <unistd.h>
+
+namespace {
+std::size_t page_size() {
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+std::size_t round_up_to_page(std::size_t size) {
+    return (size + page_size() - 1) / page_size() * page_size();
+}
+}  // namespace
+
+Scan_Buffer::~Scan_Buffer() { reset(); }
+
+Scan_Buffer::Scan_Buffer(Scan_Buffer &&other) noexcept : slot(other.slot) {
+    other.slot = nullptr;
+}
+
+Scan_Buffer &Scan_Buffer::operator=(Scan_Buffer &&other) noexcept {
+    if (this != &other) {
+        reset();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+Scan_Buffer Scan_Buffer::share() const {
+    // whoever shares already holds a reference, so nothing needs ordering until one is dropped
+    if (slot) slot->references.fetch_add(1, std::memory_order_relaxed);
+    return Scan_Buffer(slot);
+}
+
+Scan_Slot *Scan_Buffer::release() {
+    auto s = slot;
+    slot = nullptr;
+    return s;
+}
+
+Scan_Buffer Scan_Buffer::adopt(Scan_Slot *slot) { return Scan_Buffer(slot); }
+
+void Scan_Buffer::reset() {
+    // the last one to let go has to see everything the others wrote before it goes back
+    if (slot && slot->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        slot->owner->release(slot);
+    slot = nullptr;
+}
+
+std::atomic<std::uint64_t> Scan_Buffer_Pool::slab_allocations{0};
+
+Scan_Buffer_Pool::Scan_Buffer_Pool(std::size_t bs, std::size_t buffer_count)
+    : slots(new Scan_Slot[buffer_count]), buffer_size(round_up_to_page(bs)) {
+    memory =
+        static_cast<std::uint8_t *>(std::aligned_alloc(page_size(), buffer_size * buffer_count));
+    if (!memory) {
+        std::cerr << "scan buffer pool: failed to allocate " << buffer_count << " buffers of "
+                  << buffer_size << " bytes" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    slab_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    free_slots.reserve(buffer_count);
+    for (std::size_t i = 0; i < buffer_count; i++) {
+        auto &slot = slots[i];
+        slot.data = memory + i * buffer_size;
+        slot.capacity = buffer_size;
+        slot.size = 0;
+        slot.references = 0;
+        slot.owner = this;
+        slot.sequence = 0;
+        slot.timestamp_ns = 0;
+        slot.settings_hash = 0;
+        free_slots.push_back(&slot);
+    }
+}
+
+Scan_Buffer_Pool::~Scan_Buffer_Pool() { std::free(memory); }
+
+Scan_Buffer Scan_Buffer_Pool::acquire() {
+    Scan_Slot *slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+            if (outstanding++ == 0) keep_alive = shared_from_this();
+        }
+    }
+
+    if (!slot) {
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        return Scan_Buffer();
+    }
+
+    acquired.fetch_add(1, std::memory_order_relaxed);
+    slot->size = 0;
+    slot->references.store(1, std::memory_order_relaxed);
+    return Scan_Buffer(slot);
+}
+
+void Scan_Buffer_Pool::release(Scan_Slot *slot) {
+    // may be the last thing keeping us around, it has to go after the lock does
+    std::shared_ptr<Scan_Buffer_Pool> last;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_slots.push_back(slot);
+        if (--outstanding == 0) last = std::move(keep_alive);
+    }
+}
+
+std::size_t Scan_Buffer_Pool::get_buffer_size() const { return buffer_size; }
+
+std::uint64_t Scan_Buffer_Pool::get_acquired_count() const {
+    return acquired.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Scan_Buffer_Pool::get_exhausted_count() const {
+    return exhausted.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Scan_Buffer_Pool::get_slab_allocation_count() {
+    return slab_allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,124 @@
+#ifndef SCAN_BUFFER_POOL_HPP
+#define SCAN_BUFFER_POOL_HPP
+
+// standard includes
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Scan_Slot;
+
+// Whatever handed a slot out, it gets the slot back once the last handle to it is gone.
+class Scan_Slot_Owner {
+public:
+    virtual ~Scan_Slot_Owner() = default;
+    virtual void release(Scan_Slot *slot) = 0;
+};
+
+// Memory scan data is in, along with how many handles there are to it.
+struct Scan_Slot {
+    std::uint8_t *data;
+    std::size_t capacity;  // bytes data has room for
+    std::size_t size;      // bytes of scan data in it
+    std::atomic<std::uint32_t> references;
+    Scan_Slot_Owner *owner;
+
+    // stamped by the controller once the data is in
+    std::uint64_t sequence;       // scans read since the controller started
+    std::int64_t timestamp_ns;    // CLOCK_REALTIME
+    std::uint32_t settings_hash;  // of the daq settings it was read with
+};
+
+// Scan data read off the quickusb board (or replayed from a capture), a handle to one of a pool's
+// buffers. Handles can only be moved, a consumer that wants to hold on to the data alongside
+// another takes a share of it. The buffer goes back to its pool once the last handle to it is
+// gone, from whichever thread that happens on. Neither moving nor sharing allocates.
+class Scan_Buffer {
+public:
+    Scan_Buffer() = default;
+    ~Scan_Buffer();
+
+    Scan_Buffer(Scan_Buffer &&other) noexcept;
+    Scan_Buffer &operator=(Scan_Buffer &&other) noexcept;
+    Scan_Buffer(const Scan_Buffer &) = delete;
+    Scan_Buffer &operator=(const Scan_Buffer &) = delete;
+
+    Scan_Buffer share() const;  // another handle to the same buffer
+
+    std::uint8_t *data() const { return slot->data; }
+    std::size_t size() const { return slot->size; }
+    std::size_t capacity() const { return slot->capacity; }
+    void set_size(std::size_t size) { slot->size = size; }  // only before it's been shared
+
+    std::uint64_t sequence() const { return slot->sequence; }
+    std::int64_t timestamp_ns() const { return slot->timestamp_ns; }
+    std::uint32_t settings_hash() const { return slot->settings_hash; }
+
+    // only before it's been shared
+    void stamp(std::uint64_t sequence, std::int64_t timestamp_ns, std::uint32_t settings_hash) {
+        slot->sequence = sequence;
+        slot->timestamp_ns = timestamp_ns;
+        slot->settings_hash = settings_hash;
+    }
+
+    explicit operator bool() const { return slot != nullptr; }
+
+    // Hands the handle's reference over to a bare pointer and back again, for queues that can
+    // only hold trivial types. Every released slot has to be adopted exactly once.
+    Scan_Slot *release();
+    static Scan_Buffer adopt(Scan_Slot *slot);
+
+private:
+    friend class Scan_Buffer_Pool;
+    friend class Capture_Replay;
+    explicit Scan_Buffer(Scan_Slot *s) : slot(s) {}
+
+    void reset();
+
+    Scan_Slot *slot = nullptr;
+};
+
+// A slab of scan buffers allocated once up front and handed out in turn, so the controller can
+// start its next read straight away while the server still holds on to earlier buffers. Buffers
+// start on a page boundary and are a whole number of pages long, so the usb stack can transfer
+// straight into them. Once the slab is allocated, handing out and taking back buffers never
+// allocates or copies. The pool keeps itself alive for as long as any of its buffers are out, so
+// it can be replaced at any time.
+class Scan_Buffer_Pool : public Scan_Slot_Owner,
+                         public std::enable_shared_from_this<Scan_Buffer_Pool> {
+public:
+    Scan_Buffer_Pool(std::size_t buffer_size, std::size_t buffer_count);
+    ~Scan_Buffer_Pool();
+
+    Scan_Buffer_Pool(const Scan_Buffer_Pool &) = delete;
+    Scan_Buffer_Pool &operator=(const Scan_Buffer_Pool &) = delete;
+
+    // a buffer of at least the pool's buffer size, or an empty one while every buffer is out
+    Scan_Buffer acquire();
+
+    std::size_t get_buffer_size() const;
+    std::uint64_t get_acquired_count() const;   // buffers handed out
+    std::uint64_t get_exhausted_count() const;  // times acquire came back empty
+
+    // slabs allocated by every pool so far, this only goes up when settings change
+    static std::uint64_t get_slab_allocation_count();
+
+private:
+    void release(Scan_Slot *slot) override;
+
+    std::uint8_t *memory;  // every buffer's data, the slab
+    std::unique_ptr<Scan_Slot[]> slots;
+    std::vector<Scan_Slot *> free_slots;  // guarded by mutex, never grows past the slot count
+    std::size_t outstanding = 0;          // guarded by mutex, slots handed out
+    std::shared_ptr<Scan_Buffer_Pool> keep_alive;  // guarded by mutex, set while any are out
+    const std::size_t buffer_size;
+    std::atomic<std::uint64_t> acquired{0};
+    std::atomic<std::uint64_t> exhausted{0};
+    std::mutex mutex;
+
+    static std::atomic<std::uint64_t> slab_allocations;
+};
+
+#endif
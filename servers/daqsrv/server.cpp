@@ -1,26 +1,135 @@
 #include "server.hpp"
 
-#include <iostream>
+// standard includes
+#include <array>
+
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
+// internal includes
+#include "defines.hpp"
 
 Server::Server(boost::asio::io_service& io_service, std::uint16_t p, Settings_Callback callback)
     : io_service(io_service),
       acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), p)),
       port(p),
-      settings_callback{callback} {}
+      scan_data_queue(daqsrv::SCAN_DATA_QUEUE_CAPACITY),
+      strand(io_service),
+      stats_timer(io_service),
+      settings_callback{callback} {
+    start_async_accept();
+    start_stats_timer();
+}
+
+Server::~Server() { discard_scan_data(); }
+
+void Server::send_scan_data(Scan_Buffer data) {
+    if (!data_started) {
+        buffers_unwanted.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // the queue holds on to the buffer's reference until the writer adopts it again, dropped data
+    // goes straight back to the controller's pool
+    auto slot = data.release();
+    if (!scan_data_queue.push(slot)) {
+        Scan_Buffer::adopt(slot);
+        buffers_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffers_queued.fetch_add(1, std::memory_order_relaxed);
+
+    // only the controller's thread updates the maximum, it doesn't need to compare and swap
+    auto depth = daqsrv::SCAN_DATA_QUEUE_CAPACITY - scan_data_queue.write_available();
+    if (depth > maximum_queue_depth.load(std::memory_order_relaxed))
+        maximum_queue_depth.store(depth, std::memory_order_relaxed);
+
+    // one post is enough no matter how much gets queued, the writer empties the queue
+    if (!write_posted.exchange(true)) boost::asio::post(strand, [&]() { write_scan_data(); });
+}
+
+void Server::write_scan_data() {
+    write_posted = false;
+    if (writing) return;  // picks up whatever got queued once it's done
+
+    Scan_Slot* slot = nullptr;
+    if (!scan_data_queue.pop(slot)) return;
+    auto data = Scan_Buffer::adopt(slot);
+
+    // the client went away or stopped asking for data since this was queued
+    if (!socket || !data_started) {
+        discard_scan_data();
+        return;
+    }
+
+    writing = true;
+    scan_data_header.size = static_cast<std::uint32_t>(data.size());
+    scan_data_header.message_type = daqsrv::daq_message_type::daqsrv_command::SCAN_DATA;
+
+    // sending header and data in one go, the data is kept alive by the handler
+    std::array<boost::asio::const_buffer, 2> buffers = {
+        boost::asio::buffer(&scan_data_header, sizeof(scan_data_header)),
+        boost::asio::buffer(data.data(), data.size())};
+    auto s = socket.get();
+    boost::asio::async_write(
+        *socket, buffers,
+        boost::asio::bind_executor(
+            strand, [&, s, data = std::move(data)](
+                        const boost::system::error_code& error, std::size_t bytes_transferred) {
+                writing = false;
+                if (!error) {
+                    buffers_sent++;
+                    bytes_sent += bytes_transferred;
+                    write_scan_data();
+                } else if (socket.get() == s) {
+                    // a new connection may have replaced the socket this was written to
+                    SLOG_ERROR("server", "encountered error when writing scan data",
+                               slog::field("error", error.message()));
+                    reset();
+                }
+            }));
+}
+
+void Server::discard_scan_data() {
+    Scan_Slot* slot = nullptr;
+    while (scan_data_queue.pop(slot)) Scan_Buffer::adopt(slot);
+}
+
+void Server::start_stats_timer() {
+    stats_timer.expires_after(std::chrono::seconds(daqsrv::SCAN_DATA_STATS_INTERVAL_SECONDS));
+    stats_timer.async_wait(boost::asio::bind_executor(
+        strand, [&, last_sent = buffers_sent, last_bytes = bytes_sent,
+                 last_dropped = buffers_dropped.load()](const boost::system::error_code& error) {
+            if (error) return;
+
+            // quiet while there's no client taking data
+            if (buffers_sent != last_sent || buffers_dropped != last_dropped)
+                SLOG_INFO("server", "scan data sent",
+                          slog::field("buffers", buffers_sent - last_sent),
+                          slog::field("mb_per_second",
+                                      (bytes_sent - last_bytes) / 1e6 /
+                                          daqsrv::SCAN_DATA_STATS_INTERVAL_SECONDS),
+                          slog::field("queued", buffers_queued.load()),
+                          slog::field("dropped", buffers_dropped.load()),
+                          slog::field("unwanted", buffers_unwanted.load()),
+                          slog::field("maximum_queue_depth", maximum_queue_depth.load()));
+            start_stats_timer();
+        }));
+}
 
 void Server::start_async_accept() {
     assert(!temp_socket);  // sanity check
     temp_socket = std::make_unique<boost::asio::ip::tcp::socket>(io_service);
     acceptor.async_accept(*temp_socket, [&](const boost::system::error_code& error) {
         if (!error) {
-            std::cout << "server: accepted connection on port " << port << std::endl;
+            SLOG_INFO("server", "accepted connection", slog::field("port", port));
             reset();                          // resetting socket before setting it
             socket = std::move(temp_socket);  // moving socket so temporary socket can start
                                               // accepting connections again
             start_read();                     // starting to read data
         } else {
-            std::cerr << "server: attempted to accept connection on port " << port
-                      << " but an error occurred: " << error.message() << std::endl;
+            SLOG_ERROR("server", "error accepting connection", slog::field("port", port),
+                       slog::field("error", error.message()));
             temp_socket.release();  // just in case
         }
 
@@ -35,6 +144,17 @@ void Server::reset() {
         socket.release();
     }
     reset_buffers();
+
+    // a new client has to ask for data all over again
+    stop_data();
+}
+
+void Server::stop_data() {
+    data_started = false;
+
+    // whatever is still queued was meant for a client that doesn't want it anymore, and the write
+    // that would have noticed may never come back. Only the strand takes buffers off the queue.
+    boost::asio::post(strand, [&]() { discard_scan_data(); });
 }
 
 void Server::start_read() {
@@ -50,23 +170,23 @@ void Server::start_read() {
 
                     switch (hdr->message_type) {
                         case daqsrv::daq_message_type::daqsrv_command::START_OFFLINE:
-                            std::cout << "server: received start offline command" << std::endl;
+                            SLOG_INFO("server", "received start offline command");
                             data_started = true;
                             break;
                         case daqsrv::daq_message_type::daqsrv_command::START_ONLINE:
-                            std::cout << "server: received start online command" << std::endl;
+                            SLOG_INFO("server", "received start online command");
                             data_started = true;
                             break;
                         case daqsrv::daq_message_type::daqsrv_command::START_SCAN:
-                            std::cout << "server: received start scan command" << std::endl;
+                            SLOG_INFO("server", "received start scan command");
                             data_started = true;
                             break;
                         case daqsrv::daq_message_type::daqsrv_command::STOP_DATA:
-                            std::cout << "server: received stop data command" << std::endl;
-                            data_started = false;
+                            SLOG_INFO("server", "received stop data command");
+                            stop_data();
                             break;
                         case daqsrv::daq_message_type::daqsrv_command::DAQ_SETTINGS:
-                            std::cout << "server: received daq settings" << std::endl;
+                            SLOG_INFO("server", "received daq settings");
                             boost::asio::async_read(
                                 *socket, message_buffer,
                                 boost::asio::transfer_exactly(sizeof(daqsrv::daq_settings_type)),
@@ -84,23 +204,25 @@ void Server::start_read() {
                                             reset_buffers();
                                             start_read();
                                         } else {
-                                            std::cerr
-                                                << "server: received invalid settings size of: "
-                                                << bytes_transferred << ", expected: "
-                                                << sizeof(daqsrv::daq_settings_type) << std::endl;
+                                            SLOG_ERROR(
+                                                "server", "received invalid settings size",
+                                                slog::field("size", bytes_transferred),
+                                                slog::field("expected",
+                                                            sizeof(daqsrv::daq_settings_type)));
                                             reset();
                                         }
                                     } else {
-                                        std::cerr
-                                            << "server: encountered error when reading settings: "
-                                            << error.message() << std::endl;
+                                        SLOG_ERROR("server",
+                                                   "encountered error when reading settings",
+                                                   slog::field("error", error.message()));
                                         reset();
                                     }
                                 });
                             return;
                         default:
-                            std::cerr << "server: received unknown command, resetting socket"
-                                      << std::endl;
+                            SLOG_ERROR("server", "received unknown command, resetting socket",
+                                       slog::field("command", static_cast<std::uint32_t>(
+                                                                  hdr->message_type)));
                             reset();
                             return;
                     }
@@ -108,13 +230,14 @@ void Server::start_read() {
                     reset_buffers();
                     start_read();
                 } else {
-                    std::cerr << "server: received invalid header size of: " << bytes_transferred
-                              << ", expected: " << sizeof(daqsrv::daq_message_type) << std::endl;
+                    SLOG_ERROR("server", "received invalid header size",
+                               slog::field("size", bytes_transferred),
+                               slog::field("expected", sizeof(daqsrv::daq_message_type)));
                     reset();
                 }
             } else {
-                std::cerr << "server: encountered error when reading header: " << error.message()
-                          << std::endl;
+                SLOG_ERROR("server", "encountered error when reading header",
+                           slog::field("error", error.message()));
                 reset();
             }
         });
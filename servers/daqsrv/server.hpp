@@ -3,20 +3,36 @@
 
 // boost includes
 #include <boost/asio.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+// standard includes
+#include <atomic>
+#include <memory>
 
 // internal includes
 #include "daq_message_type.hpp"
+#include "scan_buffer_pool.hpp"
 
 class Server {
 public:
     using Settings_Callback = std::function<void(daqsrv::daq_settings_type)>;
     Server(boost::asio::io_service &io_service, std::uint16_t port, Settings_Callback callback);
+    ~Server();
+
+    // Hands scan data to the client, called from the controller's thread (and only from it). Data
+    // is only kept while the client has asked for it, and dropped once the client falls
+    // SCAN_DATA_QUEUE_CAPACITY buffers behind rather than holding up the controller.
+    void send_scan_data(Scan_Buffer data);
 
 private:
     void reset();               // resets socket connection that server was corresponding with
     void reset_buffers();       // resets buffer streams for received data
     void start_async_accept();  // starts listening for new connections on the socket
     void start_read();          // start reading data off tcp connection
+    void write_scan_data();     // writes queued scan data until there's none left
+    void discard_scan_data();
+    void stop_data();           // stops sending scan data, dropping whatever is still queued
+    void start_stats_timer();
 
     // asio objects
     boost::asio::io_service &io_service;
@@ -33,8 +49,27 @@ private:
     boost::asio::streambuf header_buffer;
     boost::asio::streambuf message_buffer;
 
-    bool data_started = false;  // used to keep track of if scan data should be sent to socket
-    const std::uint16_t port;   // keeping track of the port number
+    // used to keep track of if scan data should be sent to socket, the controller's thread reads it
+    std::atomic<bool> data_started{false};
+    const std::uint16_t port;  // keeping track of the port number
+
+    // scan data on its way from the controller's thread to the socket, written out on the strand
+    // one buffer at a time, header and data in a single write. Slots are released buffers, the
+    // queue only takes types it can copy.
+    boost::lockfree::spsc_queue<Scan_Slot *> scan_data_queue;
+    boost::asio::io_service::strand strand;
+    std::atomic<bool> write_posted{false};  // a write_scan_data is already on its way
+    bool writing = false;
+    daqsrv::daq_message_type scan_data_header;  // kept alive for as long as the write is
+
+    // counted since we started, the stats timer reports what changed since it last ran
+    std::atomic<std::uint64_t> buffers_queued{0};
+    std::atomic<std::uint64_t> buffers_unwanted{0};  // came in while the client didn't want data
+    std::atomic<std::uint64_t> buffers_dropped{0};   // the client wasn't keeping up
+    std::atomic<std::size_t> maximum_queue_depth{0};
+    std::uint64_t buffers_sent = 0;
+    std::uint64_t bytes_sent = 0;
+    boost::asio::steady_timer stats_timer;
 
     Settings_Callback settings_callback;  // updates the daq settings
 };
@@ -0,0 +1,158 @@
+#ifndef SIS_LOGGER_HPP
+#define SIS_LOGGER_HPP
+
+// standard includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Log levels, anything below SLOG_LEVEL is compiled out entirely (e.g. build with
+// -DSLOG_LEVEL=SLOG_LEVEL_DEBUG to get debug messages back).
+#define SLOG_LEVEL_TRACE 0
+#define SLOG_LEVEL_DEBUG 1
+#define SLOG_LEVEL_INFO 2
+#define SLOG_LEVEL_WARNING 3
+#define SLOG_LEVEL_ERROR 4
+
+#ifndef SLOG_LEVEL
+#define SLOG_LEVEL SLOG_LEVEL_INFO
+#endif
+
+// logging a message: SLOG_INFO("squsb", "opened quickusb device", slog::field("name", name)). The
+// component and message have to be string literals, fields get copied.
+#define SLOG_LOG(lvl, level_value, component, ...)                     \
+    do {                                                               \
+        if constexpr (level_value >= SLOG_LEVEL)                       \
+            ::slog::write(::slog::level::lvl, component, __VA_ARGS__); \
+    } while (0)
+
+#define SLOG_TRACE(component, ...) SLOG_LOG(trace, SLOG_LEVEL_TRACE, component, __VA_ARGS__)
+#define SLOG_DEBUG(component, ...) SLOG_LOG(debug, SLOG_LEVEL_DEBUG, component, __VA_ARGS__)
+#define SLOG_INFO(component, ...) SLOG_LOG(info, SLOG_LEVEL_INFO, component, __VA_ARGS__)
+#define SLOG_WARNING(component, ...) SLOG_LOG(warning, SLOG_LEVEL_WARNING, component, __VA_ARGS__)
+#define SLOG_ERROR(component, ...) SLOG_LOG(error, SLOG_LEVEL_ERROR, component, __VA_ARGS__)
+
+namespace slog {
+enum class level : std::uint8_t { trace, debug, info, warning, error };
+
+const std::size_t MAXIMUM_FIELDS = 8;       // fields a single message can have
+const std::size_t MAXIMUM_TEXT = 256;       // bytes of string fields a message can carry
+const std::size_t QUEUE_CAPACITY = 1024;    // messages waiting before any are dropped
+const unsigned int FLUSH_INTERVAL_MS = 10;  // how long the flusher sleeps once it's caught up
+
+// A key and value logged along with a message. Keys have to be string literals, values are copied
+// when the message is logged, strings are cut short once a message runs out of room for them.
+class field {
+public:
+    enum class kind : std::uint8_t { SIGNED, UNSIGNED, FLOATING, BOOLEAN, STRING };
+
+    template <typename T,
+              std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value, int> = 0>
+    field(const char *k, T v) : key(k), type(kind::SIGNED), i(v) {}
+    template <typename T,
+              std::enable_if_t<std::is_unsigned<T>::value && !std::is_same<T, bool>::value,
+                               int> = 0>
+    field(const char *k, T v) : key(k), type(kind::UNSIGNED), u(v) {}
+    template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+    field(const char *k, T v) : key(k), type(kind::FLOATING), d(v) {}
+    field(const char *k, bool v) : key(k), type(kind::BOOLEAN), u(v) {}
+    field(const char *k, const char *v) : key(k), type(kind::STRING), s{v, std::strlen(v)} {}
+    field(const char *k, const std::string &v)
+        : key(k), type(kind::STRING), s{v.data(), v.size()} {}
+
+    const char *key;
+    kind type;
+    union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        struct {
+            const char *data;
+            std::size_t size;
+        } s;  // only valid while the message is being logged
+    };
+};
+
+// What gets queued for the flusher, a fixed size so logging never allocates.
+struct record {
+    struct stored_field {
+        const char *key;
+        field::kind type;
+        union {
+            std::int64_t i;
+            std::uint64_t u;
+            double d;
+            struct {
+                std::uint16_t offset;  // into text
+                std::uint16_t size;
+            } s;
+        };
+    };
+
+    std::int64_t wall_ns;
+    const char *component;
+    const char *message;
+    level lvl;
+    std::uint8_t field_count;
+    std::uint16_t text_size;
+    stored_field fields[MAXIMUM_FIELDS];
+    char text[MAXIMUM_TEXT];
+};
+
+// Queues a record for the flusher thread, which is started the first time anything gets logged.
+// Never blocks and never allocates, when the queue is full the record is dropped (and counted).
+void submit(const record &r);
+
+// number of records dropped because the flusher couldn't keep up
+std::uint64_t get_dropped_count();
+
+std::int64_t wall_clock_ns();
+
+// copies a field into the record, string fields are cut short once the record runs out of room
+inline void add_field(record &r, const field &f) {
+    auto &stored = r.fields[r.field_count++];
+    stored.key = f.key;
+    stored.type = f.type;
+    switch (f.type) {
+        case field::kind::SIGNED:
+            stored.i = f.i;
+            break;
+        case field::kind::FLOATING:
+            stored.d = f.d;
+            break;
+        case field::kind::STRING: {
+            auto size = std::min(f.s.size, MAXIMUM_TEXT - r.text_size);
+            std::memcpy(r.text + r.text_size, f.s.data, size);
+            stored.s.offset = r.text_size;
+            stored.s.size = static_cast<std::uint16_t>(size);
+            r.text_size += static_cast<std::uint16_t>(size);
+            break;
+        }
+        default:
+            stored.u = f.u;
+            break;
+    }
+}
+
+// use the SLOG_ macros instead, those compile out levels that aren't wanted
+template <std::size_t C, std::size_t M, typename... Fields>
+void write(level lvl, const char (&component)[C], const char (&message)[M],
+           const Fields &...fields) {
+    static_assert(sizeof...(Fields) <= MAXIMUM_FIELDS, "too many fields for one message");
+
+    record r;
+    r.wall_ns = wall_clock_ns();
+    r.component = component;
+    r.message = message;
+    r.lvl = lvl;
+    r.field_count = 0;
+    r.text_size = 0;
+    (add_field(r, fields), ...);
+
+    submit(r);
+}
+}  // namespace slog
+
+#endif
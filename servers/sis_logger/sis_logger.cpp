@@ -0,0 +1,162 @@
+#include "sis_logger.hpp"
+
+// boost includes
+#include <boost/lockfree/queue.hpp>
+
+// standard includes
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// c includes
+#include <time.h>
+
+namespace {
+const char *level_name(slog::level lvl) {
+    switch (lvl) {
+        case slog::level::trace:
+            return "trace";
+        case slog::level::debug:
+            return "debug";
+        case slog::level::info:
+            return "info";
+        case slog::level::warning:
+            return "warning";
+        case slog::level::error:
+            return "error";
+    }
+
+    return "unknown";
+}
+
+// strings with spaces in them get quoted so fields can still be told apart
+void append_string(std::string &line, const char *data, std::size_t size) {
+    bool quote = size == 0 || std::memchr(data, ' ', size) != nullptr;
+    if (quote) line += '"';
+    line.append(data, size);
+    if (quote) line += '"';
+}
+
+// e.g. "2024-03-01 12:00:00.123456 info squsb: opened quickusb device name=\"QUSB-0\""
+void format(std::string &line, const slog::record &r) {
+    char timestamp[64];
+    time_t seconds = r.wall_ns / 1000000000;
+    struct tm local;
+    localtime_r(&seconds, &local);
+    auto length = strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    snprintf(timestamp + length, sizeof(timestamp) - length, ".%06ld",
+             static_cast<long>(r.wall_ns % 1000000000 / 1000));
+
+    line = timestamp;
+    line += ' ';
+    line += level_name(r.lvl);
+    line += ' ';
+    line += r.component;
+    line += ": ";
+    line += r.message;
+
+    for (std::uint8_t i = 0; i < r.field_count; i++) {
+        const auto &f = r.fields[i];
+        line += ' ';
+        line += f.key;
+        line += '=';
+        switch (f.type) {
+            case slog::field::kind::SIGNED:
+                line += std::to_string(f.i);
+                break;
+            case slog::field::kind::UNSIGNED:
+                line += std::to_string(f.u);
+                break;
+            case slog::field::kind::FLOATING:
+                line += std::to_string(f.d);
+                break;
+            case slog::field::kind::BOOLEAN:
+                line += f.u ? "true" : "false";
+                break;
+            case slog::field::kind::STRING:
+                append_string(line, r.text + f.s.offset, f.s.size);
+                break;
+        }
+    }
+
+    line += '\n';
+}
+
+// Owns the queue and the thread writing it out. Logging threads only ever push onto the queue, the
+// flusher formats records and writes them out in batches, only flushing once it has caught up.
+// Warnings and errors go to stderr, everything else to stdout.
+class logger {
+public:
+    logger() : records(slog::QUEUE_CAPACITY) {
+        flusher = std::thread([this]() { run(); });
+    }
+
+    // whatever is still queued gets written out, including on std::exit
+    ~logger() {
+        stopping = true;
+        flusher.join();
+    }
+
+    void submit(const slog::record &r) {
+        if (!records.bounded_push(r)) dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        std::string line;
+        std::uint64_t reported_dropped = 0;
+
+        while (true) {
+            // read before draining, so nothing queued before we were told to stop is left behind
+            bool stop = stopping;
+
+            bool wrote_out = false, wrote_err = false;
+            slog::record r;
+            while (records.pop(r)) {
+                format(line, r);
+                auto stream = r.lvl >= slog::level::warning ? stderr : stdout;
+                std::fwrite(line.data(), 1, line.size(), stream);
+                (stream == stderr ? wrote_err : wrote_out) = true;
+            }
+
+            auto d = get_dropped_count();
+            if (d != reported_dropped) {
+                std::fprintf(stderr, "slog: dropped %llu messages, logging is falling behind\n",
+                             static_cast<unsigned long long>(d - reported_dropped));
+                reported_dropped = d;
+                wrote_err = true;
+            }
+
+            if (wrote_out) std::fflush(stdout);
+            if (wrote_err) std::fflush(stderr);
+            if (stop) return;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(slog::FLUSH_INTERVAL_MS));
+        }
+    }
+
+    // fixed size, pushing never allocates
+    boost::lockfree::queue<slog::record, boost::lockfree::fixed_sized<true>> records;
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::thread flusher;
+};
+
+logger &instance() {
+    static logger l;
+    return l;
+}
+}  // namespace
+
+void slog::submit(const record &r) { instance().submit(r); }
+
+std::uint64_t slog::get_dropped_count() { return instance().get_dropped_count(); }
+
+std::int64_t slog::wall_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
@@ -30,6 +30,12 @@ public:
     // other quickusb commands
     std::tuple<bool, unsigned char> read_adc(QWORD address, unsigned char* data);
     bool read_data(unsigned char* data, unsigned long* length);
+
+    // Starts reading length bytes into data without waiting for them, the transaction identifies
+    // the read to wait on. data and length have to stay around until the read has been waited on,
+    // reads finish in the order they were started.
+    bool read_data_async(unsigned char* data, unsigned long* length, unsigned char* transaction);
+    bool wait_for_read(unsigned char transaction, unsigned long* byte_count);  // blocks until done
     bool set_DAC(unsigned char dac, unsigned char channel, unsigned char value);
     bool set_port_direction(int port, int direction);
     bool write_port(unsigned short address, unsigned char* data, unsigned short length);
@@ -1,27 +1,29 @@
 #include "sis_quick_usb.hpp"
 
 // standard includes
-#include <iostream>
 #include <vector>
 
+// sis logger includes
+#include <sis_logger/sis_logger.hpp>
+
 namespace {
 const unsigned char POWERDAC = 0x03;
 const unsigned char DAC_ADDRESS[3] = {0x10, 0x11, 0x12};
 const unsigned char ADC_ADDRESS[3] = {0x48, 0x49, 0x4a};
 
-void print_dev_null_error() { std::cerr << "squsb: failed: device handle is null" << std::endl; }
+void print_dev_null_error() { SLOG_ERROR("squsb", "failed: device handle is null"); }
 
 void print_last_error_message() {
     QULONG ec;
     QuickUsbGetLastError(&ec);
-    std::cerr << "squsb: last error code: " << ec << std::endl;
+    SLOG_ERROR("squsb", "last error", slog::field("code", ec));
 }
 }  // namespace
 
 squsb::squsb::squsb() {}
 
 bool squsb::squsb::connect_to_qusb(const char begin_serial_number, QLONG timeout) {
-    std::cout << "squsb: attempting to connect to quickusb" << std::endl;
+    SLOG_INFO("squsb", "attempting to connect to quickusb");
     current_begin_serial_number = begin_serial_number;
     current_quick_usb_timeout = timeout;
 
@@ -36,11 +38,11 @@ bool squsb::squsb::connect_to_qusb(const char begin_serial_number, QLONG timeout
                 break;
             else {
                 dev_idx.push_back(i);
-                std::cout << "squsb: Found: " << std::string(&dev_name[i]).c_str() << std::endl;
+                SLOG_INFO("squsb", "found quickusb module", slog::field("name", &dev_name[i]));
             }
         }
     } else {
-        std::cerr << "squsb: failed to find any quick usb modules" << std::endl;
+        SLOG_ERROR("squsb", "failed to find any quick usb modules");
         print_last_error_message();
         return false;
     }
@@ -48,14 +50,14 @@ bool squsb::squsb::connect_to_qusb(const char begin_serial_number, QLONG timeout
     for (const auto& i : dev_idx) {
         auto dn = std::string(&dev_name[i]);
         if (QuickUsbOpen(&dev_handle, &dev_name[i])) {
-            std::cout << "squsb: opened quickusb device: " << dn << std::endl;
+            SLOG_INFO("squsb", "opened quickusb device", slog::field("name", dn));
 
             // setting default timeout of QuickUsb Module
             if (QuickUsbSetTimeout(dev_handle, current_quick_usb_timeout)) {
-                std::cout << "squsb: set quickusb timeout to " << current_quick_usb_timeout
-                          << std::endl;
+                SLOG_INFO("squsb", "set quickusb timeout",
+                          slog::field("timeout", current_quick_usb_timeout));
             } else {
-                std::cerr << "squsb: failed to set quick usb timeout" << std::endl;
+                SLOG_ERROR("squsb", "failed to set quick usb timeout");
                 print_last_error_message();
                 return false;
             }
@@ -63,39 +65,40 @@ bool squsb::squsb::connect_to_qusb(const char begin_serial_number, QLONG timeout
             // getting serial number from quickusb
             char serial[128];
             if (QuickUsbGetStringDescriptor(dev_handle, QUICKUSB_SERIAL, serial, sizeof(serial))) {
-                std::cout << "found serial number: " << dn << std::endl;
+                SLOG_INFO("squsb", "found serial number", slog::field("name", dn),
+                          slog::field("serial", serial));
                 if (serial[0] == current_begin_serial_number) {
-                    std::cout << "squsb: DAQ QuickUSB confirmed by serial number" << std::endl;
+                    SLOG_INFO("squsb", "DAQ QuickUSB confirmed by serial number");
                     return true;
                 }
             } else {
-                std::cerr << "squsb: failed to find serial number of quickusb device: " << dn
-                          << std::endl;
+                SLOG_ERROR("squsb", "failed to find serial number of quickusb device",
+                           slog::field("name", dn));
                 print_last_error_message();
                 return false;
             }
 
             // if we make it to here this is not the usb we want so we close it
             if (!QuickUsbClose(dev_handle)) {
-                std::cerr << "squsb: failed to close: " << dn << std::endl;
+                SLOG_ERROR("squsb", "failed to close", slog::field("name", dn));
                 print_last_error_message();
                 return false;
             } else
-                std::cout << "squsb: closed quickusb device: " << dn << std::endl;
+                SLOG_INFO("squsb", "closed quickusb device", slog::field("name", dn));
         } else {
-            std::cerr << "squsb: failed to open quickusb device: " << dn << std::endl;
+            SLOG_ERROR("squsb", "failed to open quickusb device", slog::field("name", dn));
             print_last_error_message();
         }
     }
 
-    std::cerr << "squsb: failed to connect to QuickUSB Device" << std::endl;
+    SLOG_ERROR("squsb", "failed to connect to QuickUSB Device");
     return false;
 }
 
 bool squsb::squsb::disconnect_from_qusb() {
     // nonzero on success
     if (!QuickUsbClose(dev_handle)) {
-        std::cerr << "squsb: failed to close QuickUSB device" << std::endl;
+        SLOG_ERROR("squsb", "failed to close QuickUSB device");
         print_last_error_message();
         return false;
     }
@@ -114,12 +117,12 @@ std::tuple<bool, QWORD> squsb::squsb::read_quickusb_setting(QWORD address) {
     QWORD stg;
     bool res = false;
 
-    std::cout << "squsb: reading quickusb setting " << static_cast<int>(address) << std::endl;
+    SLOG_DEBUG("squsb", "reading quickusb setting", slog::field("address", address));
 
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbReadSetting(dev_handle, address, &stg)) {
-        std::cerr << "squsb: failed to read QuickUsb read setting" << std::endl;
+        SLOG_ERROR("squsb", "failed to read QuickUsb setting", slog::field("address", address));
         print_last_error_message();
     } else
         res = true;
@@ -136,10 +139,10 @@ bool squsb::squsb::write_fpga(QWORD address, char value) {
 }
 
 bool squsb::squsb::read_quickusb_command(QWORD address, unsigned char* destination, QWORD* length) {
-    std::cout << "squsb: reading quickusb command at address: " << static_cast<int>(address)
-              << std::endl;
+    SLOG_DEBUG("squsb", "reading quickusb command", slog::field("address", address));
     if (!QuickUsbReadCommand(dev_handle, address, destination, length)) {
-        std::cerr << "squsb: failed to read command from QuickUSB" << std::endl;
+        SLOG_ERROR("squsb", "failed to read command from QuickUSB",
+                   slog::field("address", address));
         return false;
     }
 
@@ -147,13 +150,13 @@ bool squsb::squsb::read_quickusb_command(QWORD address, unsigned char* destinati
 }
 
 bool squsb::squsb::write_quickusb_command(QWORD address, unsigned char* data, QWORD length) {
-    std::cout << "squsb: writing quickusb command to address " << static_cast<int>(address)
-              << std::endl;
+    SLOG_DEBUG("squsb", "writing quickusb command", slog::field("address", address),
+               slog::field("length", length));
 
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbWriteCommand(dev_handle, address, data, length)) {
-        std::cerr << "squsb: failed to write quickusb command" << std::endl;
+        SLOG_ERROR("squsb", "failed to write quickusb command", slog::field("address", address));
         print_last_error_message();
     } else
         return true;
@@ -183,14 +186,39 @@ bool squsb::squsb::read_data(unsigned char* data, unsigned long* length) {
     else if (dev_handle == nullptr)
         print_dev_null_error();
 
-    std::cerr << "squsb: failed to read data from QuickUsb" << std::endl;
+    SLOG_ERROR("squsb", "failed to read data from QuickUsb");
+    print_last_error_message();
+    return false;
+}
+
+bool squsb::squsb::read_data_async(unsigned char* data, unsigned long* length,
+                                   unsigned char* transaction) {
+    if (dev_handle != nullptr && QuickUsbReadDataAsync(dev_handle, data, length, transaction))
+        return true;
+    else if (dev_handle == nullptr)
+        print_dev_null_error();
+
+    SLOG_ERROR("squsb", "failed to start reading data from QuickUsb");
+    print_last_error_message();
+    return false;
+}
+
+bool squsb::squsb::wait_for_read(unsigned char transaction, unsigned long* byte_count) {
+    // not immediate, waiting for the read to finish rather than only checking on it
+    if (dev_handle != nullptr && QuickUsbAsyncWait(dev_handle, byte_count, transaction, 0))
+        return true;
+    else if (dev_handle == nullptr)
+        print_dev_null_error();
+
+    SLOG_ERROR("squsb", "failed waiting on data from QuickUsb",
+               slog::field("transaction", transaction));
     print_last_error_message();
     return false;
 }
 
 bool squsb::squsb::set_DAC(unsigned char dac, unsigned char channel, unsigned char value) {
-    std::cout << "squsb: setting DAC " << static_cast<int>(dac) << " channel "
-              << static_cast<int>(channel) << " value " << static_cast<int>(value) << std::endl;
+    SLOG_DEBUG("squsb", "setting DAC", slog::field("dac", dac), slog::field("channel", channel),
+               slog::field("value", value));
 
     // get command and channel value
     unsigned char cc = (POWERDAC << 4) | (channel & 0x0f);
@@ -200,7 +228,7 @@ bool squsb::squsb::set_DAC(unsigned char dac, unsigned char channel, unsigned ch
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbWriteI2C(dev_handle, DAC_ADDRESS[dac], dat, sizeof(dat))) {
-        std::cerr << "squsb: failed to write dac value" << std::endl;
+        SLOG_ERROR("squsb", "failed to write dac value", slog::field("dac", dac));
         print_last_error_message();
     } else
         return true;
@@ -209,12 +237,13 @@ bool squsb::squsb::set_DAC(unsigned char dac, unsigned char channel, unsigned ch
 }
 
 bool squsb::squsb::set_port_direction(int port, int direction) {
-    std::cout << "squsb: setting port " << port << " to direction " << direction << std::endl;
+    SLOG_DEBUG("squsb", "setting port direction", slog::field("port", port),
+               slog::field("direction", direction));
 
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbWritePortDir(dev_handle, port, direction)) {
-        std::cerr << "squsb: failed to write quickusb port direction" << std::endl;
+        SLOG_ERROR("squsb", "failed to write quickusb port direction", slog::field("port", port));
         print_last_error_message();
     } else
         return true;
@@ -223,12 +252,12 @@ bool squsb::squsb::set_port_direction(int port, int direction) {
 }
 
 bool squsb::squsb::write_port(unsigned short address, unsigned char* data, unsigned short length) {
-    std::cout << "writing port " << static_cast<int>(address) << std::endl;
+    SLOG_DEBUG("squsb", "writing port", slog::field("address", address));
 
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbWritePort(dev_handle, address, data, length)) {
-        std::cerr << "squsb: failed to write port value" << std::endl;
+        SLOG_ERROR("squsb", "failed to write port value", slog::field("address", address));
         print_last_error_message();
     } else
         return true;
@@ -237,13 +266,13 @@ bool squsb::squsb::write_port(unsigned short address, unsigned char* data, unsig
 }
 
 bool squsb::squsb::write_quickusb_setting(QWORD address, QWORD setting) {
-    std::cout << "squsb: writing quickusb setting " << static_cast<int>(setting) << " to address "
-              << static_cast<int>(address) << std::endl;
+    SLOG_DEBUG("squsb", "writing quickusb setting", slog::field("address", address),
+               slog::field("setting", setting));
 
     if (dev_handle == nullptr)
         print_dev_null_error();
     else if (!QuickUsbWriteSetting(dev_handle, address, setting)) {
-        std::cerr << "squsb: failed to write quickusb setting" << std::endl;
+        SLOG_ERROR("squsb", "failed to write quickusb setting", slog::field("address", address));
         print_last_error_message();
     } else
         return true;